@@ -14,7 +14,7 @@ const char* usage_str =
     "\n"
     "Disregarding --apple options, report remaining arguments.\n";
 
-int main(int argc, char** argv) {
+int main(int, char** argv) {
     try {
         auto print_apple = [] { std::cout << "apple!\n"; };
         auto help = [argv0 = argv[0]] { to::usage(argv0, usage_str); };
@@ -25,10 +25,11 @@ int main(int argc, char** argv) {
             { {}, to::flag, to::stop, "--" }
         };
 
-        if (!to::run(opts, argc, argv+1)) return 0;
+        to::arg_span remaining;
+        if (!to::run(opts, argv+1, remaining)) return 0;
 
         std::cout << "remaining arguments:";
-        for (auto a = argv+1; *a; ++a) std::cout << ' ' << *a;
+        for (auto a: remaining) std::cout << ' ' << a;
         std::cout << "\n";
     }
     catch (to::option_error& e) {
@@ -0,0 +1,53 @@
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <tinyopt/tinyopt.h>
+#include <tinyopt/mapped.h>
+
+const char* usage_str =
+    "[OPTION]... INDEX [KEY]...\n"
+    "\n"
+    "  --build=TEXT     build INDEX from the keys and integer values in TEXT\n"
+    "  -h, --help       display usage information and exit\n"
+    "\n"
+    "Look up each KEY in the keyword index file INDEX.\n";
+
+int main(int argc, char** argv) {
+    try {
+        to::maybe<std::string> text;
+        auto help = [argv0 = argv[0]] { to::usage(argv0, usage_str); };
+
+        to::option opts[] = {
+            { text, "--build" },
+            { to::action(help), to::flag, to::exit, "-h", "--help" }
+        };
+
+        if (!to::run(opts, argc, argv+1)) return 0;
+        if (!argv[1]) throw to::option_error("missing index file");
+        std::string index = argv[1];
+
+        if (text) {
+            std::ifstream in(*text);
+            if (!in) throw std::runtime_error("unable to open "+*text);
+            std::ofstream out(index, std::ios::binary);
+            to::build_keyword_index(in, out);
+        }
+
+        to::mapped_keyword_parser lookup(index);
+        for (char** key = argv+2; *key; ++key) {
+            std::cout << *key << ": ";
+            if (auto v = lookup(*key)) std::cout << *v << "\n";
+            else std::cout << "not found\n";
+        }
+    }
+    catch (to::option_error& e) {
+        to::usage_error(argv[0], usage_str, e.what());
+        return 1;
+    }
+    catch (std::runtime_error& e) {
+        std::cerr << argv[0] << ": " << e.what() << "\n";
+        return 1;
+    }
+}
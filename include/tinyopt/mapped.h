@@ -0,0 +1,427 @@
+#pragma once
+
+// Memory-mapped parsers for tinyopt: keyword indices and @file payloads.
+//
+// These are kept apart from tinyopt.h so that programs which do not use
+// them do not include the operating system headers they depend on.
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "tinyopt.h"
+
+#if !defined(TINYOPT_HAVE_MMAP)
+#if defined(__unix__) || defined(__APPLE__)
+#define TINYOPT_HAVE_MMAP 1
+#else
+#define TINYOPT_HAVE_MMAP 0
+#endif
+#endif
+
+#if TINYOPT_HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace to {
+
+// Memory-mapped keyword indices
+//
+// A mapped_keyword_parser looks up keys in a prebuilt index file mapping
+// strings to 64-bit integer values. The file is mapped read-only where
+// mmap is available (or otherwise read into memory once), and queried in
+// place: loading costs no more than the mapping, however large the index.
+//
+// Index files are written by write_keyword_index() from a collection of
+// key-value pairs, or by build_keyword_index() from text with one key and
+// integer value per line. As with keyword_parser, the first entry for a
+// repeated key determines its value.
+//
+// The index comprises a header, an open-addressed hash table of 32-bit
+// slots (0 for empty, otherwise 1 + entry number) keyed by the 64-bit
+// FNV-1a hash of each key, a table of entries (key offset, key length,
+// value) and the pool of key bytes. It is stored in native byte order,
+// and is rejected if built on a platform of the other byte order.
+
+namespace impl {
+    struct keyword_index_header {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t n_entry;
+        std::uint64_t n_slot;
+        std::uint64_t pool_size;
+    };
+
+    struct keyword_index_entry {
+        std::uint64_t offset;
+        std::uint64_t length;
+        std::int64_t value;
+    };
+
+    constexpr char keyword_index_magic[4] = {'T', 'O', 'K', 'W'};
+    constexpr std::uint32_t keyword_index_version = 1;
+
+    // Read-only contents of a file, memory mapped if possible.
+    class mapped_file {
+        const char* data_ = nullptr;
+        std::size_t size_ = 0;
+#if TINYOPT_HAVE_MMAP
+        void* map_ = nullptr;
+#else
+        std::vector<std::uint64_t> buf_;
+#endif
+
+    public:
+        explicit mapped_file(const std::string& path) {
+#if TINYOPT_HAVE_MMAP
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd<0) throw std::runtime_error("unable to open "+path);
+
+            struct stat st;
+            if (::fstat(fd, &st)<0) {
+                ::close(fd);
+                throw std::runtime_error("unable to stat "+path);
+            }
+
+            size_ = static_cast<std::size_t>(st.st_size);
+            if (size_) {
+                map_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (map_==MAP_FAILED) map_ = nullptr;
+            }
+            ::close(fd);
+
+            if (size_ && !map_) throw std::runtime_error("unable to map "+path);
+            data_ = static_cast<const char*>(map_);
+#else
+            std::ifstream in(path, std::ios::binary|std::ios::ate);
+            if (!in) throw std::runtime_error("unable to open "+path);
+
+            size_ = static_cast<std::size_t>(in.tellg());
+            buf_.resize((size_+7)/8);
+            in.seekg(0);
+            if (!in.read(reinterpret_cast<char*>(buf_.data()), size_)) throw std::runtime_error("unable to read "+path);
+            data_ = reinterpret_cast<const char*>(buf_.data());
+#endif
+        }
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        ~mapped_file() {
+#if TINYOPT_HAVE_MMAP
+            if (map_) ::munmap(map_, size_);
+#endif
+        }
+
+        const char* data() const { return data_; }
+        std::size_t size() const { return size_; }
+    };
+}
+
+class mapped_keyword_parser {
+    std::shared_ptr<impl::mapped_file> file_;
+    const std::uint32_t* slots_ = nullptr;
+    const impl::keyword_index_entry* entries_ = nullptr;
+    const char* pool_ = nullptr;
+    impl::keyword_index_header header_;
+
+public:
+    explicit mapped_keyword_parser(const std::string& path):
+        file_(std::make_shared<impl::mapped_file>(path))
+    {
+        using namespace impl;
+        auto invalid = [&path]() { return std::runtime_error("invalid keyword index "+path); };
+
+        const char* p = file_->data();
+        std::size_t size = file_->size();
+
+        if (size<sizeof(header_)) throw invalid();
+        std::memcpy(&header_, p, sizeof(header_));
+        if (std::memcmp(header_.magic, keyword_index_magic, 4) || header_.version!=keyword_index_version) throw invalid();
+
+        // Slot count is a power of two, at least two, so that the entries that follow are aligned.
+        const auto& h = header_;
+        if (h.n_slot<2 || (h.n_slot&(h.n_slot-1)) || h.n_entry>=h.n_slot || h.n_slot>size/sizeof(std::uint32_t)) throw invalid();
+
+        std::size_t slots_size = h.n_slot*sizeof(std::uint32_t);
+        std::size_t entries_size = h.n_entry*sizeof(keyword_index_entry);
+        if (size-sizeof(header_)<slots_size || size-sizeof(header_)-slots_size<entries_size ||
+            size-sizeof(header_)-slots_size-entries_size<h.pool_size) throw invalid();
+
+        slots_ = reinterpret_cast<const std::uint32_t*>(p+sizeof(header_));
+        entries_ = reinterpret_cast<const keyword_index_entry*>(p+sizeof(header_)+slots_size);
+        pool_ = p+sizeof(header_)+slots_size+entries_size;
+    }
+
+    std::size_t size() const { return header_.n_entry; }
+
+    maybe<std::int64_t> operator()(const char* text) const {
+        if (!text) return nothing;
+        return (*this)(text, text+std::strlen(text));
+    }
+
+    maybe<std::int64_t> operator()(const char* b, const char* e) const {
+        std::size_t n = e-b;
+        std::uint64_t mask = header_.n_slot-1;
+
+        // Probe at most n_slot slots, lest a corrupt index have none empty.
+        std::uint64_t j = impl::fnv1a64(b, n)&mask;
+        for (std::uint64_t k = 0; k<header_.n_slot && slots_[j]; ++k, j = (j+1)&mask) {
+            std::uint32_t i = slots_[j]-1;
+            if (i>=header_.n_entry) return nothing;
+
+            const auto& entry = entries_[i];
+            if (entry.length==n && n<=header_.pool_size && entry.offset<=header_.pool_size-n && !std::memcmp(pool_+entry.offset, b, n)) {
+                return entry.value;
+            }
+        }
+        return nothing;
+    }
+
+#if __cplusplus>=201703
+    maybe<std::int64_t> operator()(std::string_view text) const {
+        return (*this)(text.data(), text.data()+text.size());
+    }
+#endif
+};
+
+// Write an index for mapped_keyword_parser to out from pairs of keys
+// (convertible to std::string) and integer values.
+
+template <typename KeywordPairs>
+void write_keyword_index(std::ostream& out, const KeywordPairs& pairs) {
+    using namespace impl;
+
+    std::size_t n_pair = 0;
+    for (const auto& kv: pairs) (void)kv, ++n_pair;
+    if (n_pair>=std::numeric_limits<std::uint32_t>::max()/2) throw std::runtime_error("too many keywords for index");
+
+    keyword_index_header header{};
+    std::memcpy(header.magic, keyword_index_magic, 4);
+    header.version = keyword_index_version;
+    header.n_slot = pow2_ceil(2*n_pair>2? 2*n_pair: 2);
+
+    std::vector<std::uint32_t> slots(header.n_slot, 0);
+    std::vector<keyword_index_entry> entries;
+    std::string pool;
+
+    const std::uint64_t mask = header.n_slot-1;
+    for (const auto& kv: pairs) {
+        const std::string key(std::get<0>(kv));
+        std::uint64_t j = fnv1a64(key.data(), key.size())&mask;
+
+        bool dup = false;
+        for (; slots[j] && !dup; j = (j+1)&mask) {
+            const auto& e = entries[slots[j]-1];
+            dup = e.length==key.size() && !pool.compare(e.offset, e.length, key);
+        }
+        if (dup) continue;
+
+        slots[j] = static_cast<std::uint32_t>(entries.size()+1);
+        entries.push_back({pool.size(), key.size(), static_cast<std::int64_t>(std::get<1>(kv))});
+        pool += key;
+    }
+
+    header.n_entry = entries.size();
+    header.pool_size = pool.size();
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(slots.data()), slots.size()*sizeof(std::uint32_t));
+    out.write(reinterpret_cast<const char*>(entries.data()), entries.size()*sizeof(keyword_index_entry));
+    out.write(pool.data(), pool.size());
+    if (!out) throw std::runtime_error("unable to write keyword index");
+}
+
+// Write an index for mapped_keyword_parser to out from text comprising
+// lines of a key followed by white space and an integer value. Blank
+// lines and lines beginning with '#' are ignored.
+
+inline void build_keyword_index(std::istream& in, std::ostream& out) {
+    std::vector<std::pair<std::string, std::int64_t>> pairs;
+    std::string line;
+
+    for (std::size_t n = 1; std::getline(in, line); ++n) {
+        const char* b = line.data();
+        const char* e = b+line.size();
+        const char* k = impl::skip_space(b, e);
+        if (k==e || *k=='#') continue;
+
+        const char* v = k;
+        while (v!=e && !impl::is_space(*v)) ++v;
+
+        auto value = default_parser<std::int64_t>{}(v, e);
+        if (v==e || !value) throw std::runtime_error("invalid keyword index entry at line "+std::to_string(n));
+        pairs.emplace_back(std::string(k, v), *value);
+    }
+
+    write_keyword_index(out, pairs);
+}
+
+// Memory-mapped file payloads
+//
+// mapped_array_parser<T> accepts an argument of the form "@path" and maps
+// the file at path read-only as an array of T, returned as a mapped_span<T>
+// that keeps the mapping alive for as long as it or any copy exists. The
+// file size must be a multiple of sizeof(T), and if a count is given to
+// the parser, the array must have exactly that many elements. T must be
+// trivially copyable; the file contents are taken as is, in native byte
+// order and representation.
+//
+// mapped_text_parser similarly maps a text file, returned as a mapped_text
+// whose records, separated by a delimiter character (by default newline;
+// '\0' for NUL-separated records), can be iterated over in place. A final
+// delimiter at the end of the file does not introduce an empty record.
+//
+// Arguments without the '@' prefix, or files that cannot be read or do not
+// satisfy the size constraints, are parse failures. A mapped file must not
+// be truncated while it is in use.
+
+template <typename T>
+class mapped_span {
+    static_assert(std::is_trivially_copyable<T>::value, "mapped_span element type must be trivially copyable");
+
+    std::shared_ptr<const impl::mapped_file> file_;
+    const T* data_ = nullptr;
+    std::size_t size_ = 0;
+
+public:
+    using value_type = T;
+    using const_iterator = const T*;
+
+    mapped_span() = default;
+    mapped_span(std::shared_ptr<const impl::mapped_file> file, const T* data, std::size_t size):
+        file_(std::move(file)), data_(data), size_(size) {}
+
+    const T* data() const { return data_; }
+    std::size_t size() const { return size_; }
+    bool empty() const { return !size_; }
+
+    const T& operator[](std::size_t i) const { return data_[i]; }
+    const T* begin() const { return data_; }
+    const T* end() const { return data_+size_; }
+};
+
+namespace impl {
+    // Map the file named by an "@path" argument, or return null.
+    inline std::shared_ptr<const mapped_file> map_at_file(const char* text) {
+        if (!text || *text!='@') return nullptr;
+        try {
+            return std::make_shared<const mapped_file>(text+1);
+        }
+        catch (std::runtime_error&) {
+            return nullptr;
+        }
+    }
+}
+
+template <typename T>
+class mapped_array_parser {
+    std::size_t count_;
+
+public:
+    explicit mapped_array_parser(std::size_t count = 0): count_(count) {}
+
+    maybe<mapped_span<T>> operator()(const char* text) const {
+        auto file = impl::map_at_file(text);
+        if (!file) return nothing;
+
+        std::size_t n = file->size()/sizeof(T);
+        if (file->size()%sizeof(T) || (count_ && n!=count_)) return nothing;
+        if (reinterpret_cast<std::uintptr_t>(file->data())%alignof(T)) return nothing;
+
+        const T* data = reinterpret_cast<const T*>(file->data());
+        return mapped_span<T>(std::move(file), data, n);
+    }
+};
+
+class mapped_text: public mapped_span<char> {
+    char delim_ = '\n';
+
+public:
+    struct record {
+        const char* first;
+        const char* last;
+
+        const char* begin() const { return first; }
+        const char* end() const { return last; }
+        std::size_t size() const { return last-first; }
+        std::string str() const { return std::string(first, last); }
+#if __cplusplus>=201703
+        std::string_view view() const { return std::string_view(first, last-first); }
+#endif
+    };
+
+    struct iterator {
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = record;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const record*;
+        using reference = const record&;
+
+        iterator() = default;
+        iterator(const char* p, const char* end, char delim): end_(end), delim_(delim) { next(p); }
+
+        const record& operator*() const { return r_; }
+        const record* operator->() const { return &r_; }
+
+        iterator& operator++() {
+            next(r_.last==end_? end_: r_.last+1);
+            return *this;
+        }
+
+        iterator operator++(int) { auto x = *this; return ++*this, x; }
+
+        bool operator==(const iterator& x) const { return r_.first==x.r_.first; }
+        bool operator!=(const iterator& x) const { return !(*this==x); }
+
+    private:
+        record r_{nullptr, nullptr};
+        const char* end_ = nullptr;
+        char delim_ = '\n';
+
+        void next(const char* p) {
+            r_.first = p;
+            r_.last = p==end_? p: impl::find_delim(p, end_, delim_);
+        }
+    };
+
+    mapped_text() = default;
+    mapped_text(mapped_span<char> span, char delim): mapped_span<char>(std::move(span)), delim_(delim) {}
+
+    iterator begin() const { return iterator(data(), data()+size(), delim_); }
+    iterator end() const { return iterator(data()+size(), data()+size(), delim_); }
+};
+
+class mapped_text_parser {
+    char delim_;
+
+public:
+    explicit mapped_text_parser(char delim = '\n'): delim_(delim) {}
+
+    maybe<mapped_text> operator()(const char* text) const {
+        if (auto span = mapped_array_parser<char>{}(text)) return mapped_text(*std::move(span), delim_);
+        else return nothing;
+    }
+};
+
+template <typename T>
+mapped_array_parser<T> mapped_array(std::size_t count = 0) {
+    return mapped_array_parser<T>(count);
+}
+
+inline mapped_text_parser mapped_lines(char delim = '\n') {
+    return mapped_text_parser(delim);
+}
+
+} // namespace to
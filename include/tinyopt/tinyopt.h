@@ -1,19 +1,35 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <cstdlib>
 #include <cstring>
 #include <functional>
+#include <initializer_list>
 #include <iostream>
 #include <iterator>
+#include <limits>
+#include <list>
+#include <locale>
+#include <memory>
+#include <ratio>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 #if __cplusplus>=201703
+#include <charconv>
 #include <optional>
+#include <string_view>
 #endif
 
 #define TINYOPT_VERSION "1.1"
@@ -41,60 +57,158 @@ namespace to {
 //    on the left hand side, operator<< acts as a conditional
 //    assignment.
 //
+// As with std::optional, maybe<T> is trivially copyable (or trivially
+// destructible) if T is, and can be constructed in constant expressions.
+//
 // nothing is a special value that converts to an empty maybe<T> for any T.
 
 constexpr struct nothing_t {} nothing;
 
+// in_place selects the maybe<T> constructor that constructs the value
+// directly from the given arguments.
+
+constexpr struct in_place_t {} in_place;
+
+namespace impl {
+
+    // Storage for maybe<T>: a union, so that a value can be constructed
+    // in a constant expression, with a trivial destructor if T has one.
+    template <typename T, bool = std::is_trivially_destructible<T>::value>
+    struct maybe_storage {
+        union {
+            char empty_;
+            T value_;
+        };
+        bool ok = false;
+
+        constexpr maybe_storage() noexcept: empty_() {}
+
+        template <typename... A>
+        constexpr maybe_storage(in_place_t, A&&... a): value_(std::forward<A>(a)...), ok(true) {}
+    };
+
+    template <typename T>
+    struct maybe_storage<T, false> {
+        union {
+            char empty_;
+            T value_;
+        };
+        bool ok = false;
+
+        constexpr maybe_storage() noexcept: empty_() {}
+
+        template <typename... A>
+        constexpr maybe_storage(in_place_t, A&&... a): value_(std::forward<A>(a)...), ok(true) {}
+
+        maybe_storage(const maybe_storage&) = delete;
+        maybe_storage& operator=(const maybe_storage&) = delete;
+
+        ~maybe_storage() { if (ok) value_.~T(); }
+    };
+
+    // Value management for maybe<T>. Copy and move operations are the
+    // implicit, trivial ones if T is trivially copyable.
+    template <typename T, bool = std::is_trivially_copyable<T>::value>
+    struct maybe_base: maybe_storage<T> {
+        using maybe_storage<T>::maybe_storage;
+
+        template <typename U>
+        void construct(U&& v) { new (&this->value_) T(std::forward<U>(v)); this->ok = true; }
+
+        template <typename U>
+        void assign(U&& v) { if (this->ok) this->value_ = std::forward<U>(v); else construct(std::forward<U>(v)); }
+
+        void destroy() { if (this->ok) this->value_.~T(); this->ok = false; }
+    };
+
+    template <typename T>
+    struct maybe_base<T, false>: maybe_base<T, true> {
+        using maybe_base<T, true>::maybe_base;
+
+        maybe_base() = default;
+
+        maybe_base(const maybe_base& m) noexcept(std::is_nothrow_copy_constructible<T>::value) {
+            if (m.ok) this->construct(m.value_);
+        }
+
+        maybe_base(maybe_base&& m) noexcept(std::is_nothrow_move_constructible<T>::value) {
+            if (m.ok) this->construct(std::move(m.value_));
+        }
+
+        maybe_base& operator=(const maybe_base& m)
+            noexcept(std::is_nothrow_copy_constructible<T>::value && std::is_nothrow_copy_assignable<T>::value)
+        {
+            if (m.ok) this->assign(m.value_); else this->destroy();
+            return *this;
+        }
+
+        maybe_base& operator=(maybe_base&& m)
+            noexcept(std::is_nothrow_move_constructible<T>::value && std::is_nothrow_move_assignable<T>::value)
+        {
+            if (m.ok) this->assign(std::move(m.value_)); else this->destroy();
+            return *this;
+        }
+    };
+}
+
 template <typename T>
-struct maybe {
-    maybe() noexcept: ok(false) {}
-    maybe(nothing_t) noexcept: ok(false) {}
-    maybe(const T& v): ok(true) { construct(v); }
-    maybe(T&& v): ok(true) { construct(std::move(v)); }
-    maybe(const maybe& m): ok(m.ok) { if (ok) construct(*m); }
-    maybe(maybe&& m): ok(m.ok) { if (ok) construct(std::move(*m)); }
+struct maybe: private impl::maybe_base<T> {
+    constexpr maybe() noexcept {}
+    constexpr maybe(nothing_t) noexcept {}
+    constexpr maybe(const T& v): base(in_place, v) {}
+    constexpr maybe(T&& v): base(in_place, std::move(v)) {}
 
-    ~maybe() { destroy(); }
+    template <typename... A>
+    constexpr explicit maybe(in_place_t, A&&... a): base(in_place, std::forward<A>(a)...) {}
+
+    maybe(const maybe&) = default;
+    maybe(maybe&&) = default;
 
     template <typename U>
-    maybe(const maybe<U>& m): ok(m.ok) { if (ok) construct(*m); }
+    maybe(const maybe<U>& m) { if (m.ok) construct(*m); }
 
     template <typename U>
-    maybe(maybe<U>&& m): ok(m.ok) { if (ok) construct(std::move(*m)); }
+    maybe(maybe<U>&& m) { if (m.ok) construct(std::move(*m)); }
 
     maybe& operator=(nothing_t) { return destroy(), *this; }
     maybe& operator=(const T& v) { return assign(v), *this; }
     maybe& operator=(T&& v) { return assign(std::move(v)), *this; }
-    maybe& operator=(const maybe& m) { return m.ok? assign(*m): destroy(), *this; }
-    maybe& operator=(maybe&& m) { return m.ok? assign(std::move(*m)): destroy(), *this; }
+    maybe& operator=(const maybe&) = default;
+    maybe& operator=(maybe&&) = default;
+
+    // Destroy any current value and construct a new one in place.
+    template <typename... A>
+    T& emplace(A&&... a) {
+        destroy();
+        new (&value_) T(std::forward<A>(a)...);
+        ok = true;
+        return value_;
+    }
 
-    const T& value() const & { return assert_ok(), *vptr(); }
-    T&& value() && { return assert_ok(), std::move(*vptr()); }
+    constexpr const T& value() const & { return assert_ok(), value_; }
+    constexpr T& value() & { return assert_ok(), value_; }
+    constexpr T&& value() && { return assert_ok(), std::move(value_); }
 
-    const T& operator*() const & noexcept { return *vptr(); }
-    const T* operator->() const & noexcept { return vptr(); }
-    T&& operator*() && { return std::move(*vptr()); }
+    constexpr const T& operator*() const & noexcept { return value_; }
+    constexpr T& operator*() & noexcept { return value_; }
+    constexpr const T* operator->() const & noexcept { return &value_; }
+    constexpr T* operator->() & noexcept { return &value_; }
+    constexpr T&& operator*() && { return std::move(value_); }
 
-    bool has_value() const noexcept { return ok; }
-    explicit operator bool() const noexcept { return ok; }
+    constexpr bool has_value() const noexcept { return ok; }
+    constexpr explicit operator bool() const noexcept { return ok; }
 
     template <typename> friend struct maybe;
 
 private:
-    bool ok = false;
-    alignas(T) char data[sizeof(T)];
-
-    T* vptr() noexcept { return reinterpret_cast<T*>(data); }
-    const T* vptr() const noexcept { return reinterpret_cast<const T*>(data); }
-
-    void construct(const T& v) { new (data) T(v); ok = true; }
-    void construct(T&& v) { new (data) T(std::move(v)); ok = true; }
-
-    void assign(const T& v) { if (ok) *vptr()=v; else construct(v); }
-    void assign(T&& v) { if (ok) *vptr()=std::move(v); else construct(std::move(v)); }
-
-    void destroy() { if (ok) (**this).~T(); ok = false; }
-    void assert_ok() const { if (!ok) throw std::invalid_argument("is nothing"); }
+    using base = impl::maybe_base<T>;
+    using base::ok;
+    using base::value_;
+    using base::construct;
+    using base::assign;
+    using base::destroy;
+
+    constexpr void assert_ok() const { if (!ok) throw std::invalid_argument("is nothing"); }
 };
 
 namespace impl {
@@ -142,7 +256,7 @@ constexpr maybe<void> something(true);
 // just<X> converts a value of type X to a maybe<X> containing the value.
 
 template <typename X>
-auto just(X&& x) { return maybe<std::decay_t<X>>(std::forward<X>(x)); }
+constexpr auto just(X&& x) { return maybe<std::decay_t<X>>(std::forward<X>(x)); }
 
 // operator<< offers monadic-style chaining of maybe<X> values:
 // (f << m) evaluates to an empty maybe if m is empty, or else to
@@ -169,6 +283,28 @@ maybe<R> operator<<(F&& f, const maybe<T>& m) {
     if (m) return f(*m); else return nothing;
 }
 
+// With an rvalue maybe<T>, f is applied to the moved value.
+
+template <
+    typename F,
+    typename T,
+    typename R = std::decay_t<decltype(std::declval<F>()(std::declval<T&&>()))>,
+    typename = std::enable_if_t<std::is_same<R, void>::value>
+>
+maybe<void> operator<<(F&& f, maybe<T>&& m) {
+    if (m) return f(*std::move(m)), something; else return nothing;
+}
+
+template <
+    typename F,
+    typename T,
+    typename R = std::decay_t<decltype(std::declval<F>()(std::declval<T&&>()))>,
+    typename = std::enable_if_t<!std::is_same<R, void>::value>
+>
+maybe<R> operator<<(F&& f, maybe<T>&& m) {
+    if (m) return f(*std::move(m)); else return nothing;
+}
+
 template <
     typename F,
     typename R = std::decay_t<decltype(std::declval<F>()())>,
@@ -195,6 +331,11 @@ auto operator<<(T& x, const maybe<U>& m) -> maybe<std::decay_t<decltype(x=*m)>>
     if (m) return x=*m; else return nothing;
 }
 
+template <typename T, typename U>
+auto operator<<(T& x, maybe<U>&& m) -> maybe<std::decay_t<decltype(x=*std::move(m))>> {
+    if (m) return x=*std::move(m); else return nothing;
+}
+
 template <typename T>
 auto operator<<(T& x, const maybe<void>& m) -> maybe<std::decay_t<decltype(x=true)>> {
     if (m) return x=true; else return nothing;
@@ -255,8 +396,200 @@ inline void usage_error(const char* argv0, const std::string& usage_str, const s
 // Parser objects act as functionals, taking
 // a const char* argument and returning maybe<T>
 // for some T.
+//
+// The default parser for arithmetic types scans the argument directly,
+// without constructing a stream: it does not allocate and does not
+// consult the global locale. As with stream extraction, leading and
+// trailing white space is permitted, but the rest of the argument
+// must constitute the value.
+//
+// Parsers may additionally provide an overload taking a character range
+// [b, e), which need not be NUL-terminated; see delimited_parser below.
+//
+// Parsers may also provide parse_into(text, out) -> bool (and optionally
+// parse_into(b, e, out)), which builds the value directly in out, reusing
+// any storage it already holds. Sinks, push_back and delimited_parser use
+// this when available. On failure, the contents of out are unspecified;
+// sinks parse into a scratch value so that their variable is unchanged.
 
-template <typename V>
+namespace impl {
+    inline bool is_space(char c) { return c==' ' || (c>='\t' && c<='\r'); }
+    inline bool is_digit(char c) { return c>='0' && c<='9'; }
+
+    inline const char* skip_space(const char* p, const char* e) {
+        while (p!=e && is_space(*p)) ++p;
+        return p;
+    }
+
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__==__ORDER_LITTLE_ENDIAN__
+#define TINYOPT_SWAR_DIGITS 1
+    // Count the leading decimal digits (at most 8) in the eight bytes
+    // starting at p, and compute their value, eight bytes at a time.
+    inline unsigned swar_digits8(const char* p, std::uint64_t& value) {
+        std::uint64_t x;
+        std::memcpy(&x, p, 8);
+        x ^= 0x3030303030303030ull; // Digit bytes now have values 0-9.
+
+        // High bit set in each byte > 9; carries out of such a byte
+        // only affect the bytes that follow it.
+        std::uint64_t nondigit = ((x+0x7676767676767676ull)|x)&0x8080808080808080ull;
+        unsigned n = nondigit? __builtin_ctzll(nondigit)/8: 8;
+        if (!n) return 0;
+
+        x <<= 8*(8-n); // Pad with leading zeros.
+        x = (x*10+(x>>8))&0x00ff00ff00ff00ffull;
+        x = (x*100+(x>>16))&0x0000ffff0000ffffull;
+        x = (x*10000+(x>>32))&0xffffffffull;
+        value = x;
+        return n;
+    }
+#endif
+
+    // Scan an optionally signed decimal integer of type I from [p, e).
+    // Returns pointer to the first unconsumed character, or nullptr
+    // if there is no integer or if the value is out of range.
+    template <typename I>
+    const char* scan_integer(const char* p, const char* e, I& v) {
+        using U = std::make_unsigned_t<I>;
+
+        bool neg = false;
+        if (p!=e && (*p=='+' || *p=='-')) neg = *p++=='-';
+        if (neg && !std::is_signed<I>::value) return nullptr;
+        if (p==e || !is_digit(*p)) return nullptr;
+
+        U limit = neg? U(0)-static_cast<U>(std::numeric_limits<I>::min()): static_cast<U>(std::numeric_limits<I>::max());
+        U acc = 0;
+#ifdef TINYOPT_SWAR_DIGITS
+        constexpr std::uint64_t pow10[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+        while (sizeof(U)<=8 && e-p>=8) {
+            std::uint64_t chunk = 0;
+            unsigned n = swar_digits8(p, chunk);
+            if (!n) break;
+            if (chunk>limit || acc>(limit-chunk)/pow10[n]) return nullptr;
+
+            acc = static_cast<U>(acc*pow10[n]+chunk);
+            p += n;
+            if (n<8) e = p; // No further digits to scan.
+        }
+#endif
+        for (; p!=e && is_digit(*p); ++p) {
+            unsigned d = *p-'0';
+            if (acc>(limit-d)/10) return nullptr;
+            acc = acc*10+d;
+        }
+
+        v = neg && acc? static_cast<I>(-static_cast<I>(acc-1)-1): static_cast<I>(acc);
+        return p;
+    }
+
+    // Check [p, e) starts with a decimal floating point representation,
+    // [+-]digits[.digits][(e|E)[+-]digits], with at least one digit
+    // in the mantissa. Returns pointer past representation, or nullptr.
+    inline const char* scan_float_syntax(const char* p, const char* e) {
+        auto digits = [e](const char*& p) {
+            const char* q = p;
+            while (p!=e && is_digit(*p)) ++p;
+            return p!=q;
+        };
+
+        if (p!=e && (*p=='+' || *p=='-')) ++p;
+
+        bool mantissa = digits(p);
+        if (p!=e && *p=='.') mantissa |= digits(++p);
+        if (!mantissa) return nullptr;
+
+        if (p!=e && (*p=='e' || *p=='E')) {
+            if (++p!=e && (*p=='+' || *p=='-')) ++p;
+            if (!digits(p)) return nullptr;
+        }
+        return p;
+    }
+
+#if __cplusplus>=201703 && defined(__cpp_lib_to_chars)
+    template <typename F>
+    bool convert_float(const char* b, const char* e, F& v) {
+        bool neg = *b=='-';
+        if (*b=='+' || *b=='-') ++b;
+
+        auto r = std::from_chars(b, e, v);
+        if (r.ec!=std::errc{} || r.ptr!=e) return false;
+        if (neg) v = -v;
+        return true;
+    }
+#else
+    inline float strto_float(const char* p, char** q, float) { return std::strtof(p, q); }
+    inline double strto_float(const char* p, char** q, double) { return std::strtod(p, q); }
+    inline long double strto_float(const char* p, char** q, long double) { return std::strtold(p, q); }
+
+    template <typename F>
+    bool convert_float(const char* b, const char* e, F& v) {
+        // The C library conversion requires a NUL-terminated string, so
+        // [b, e) is first copied, to a local buffer if it fits. It is also
+        // subject to LC_NUMERIC; if it disagrees with the syntax check,
+        // fall back to a classic-locale stream.
+        std::size_t n = e-b;
+        char local[64];
+        std::string copy;
+        const char* p = local;
+        if (n<sizeof(local)) {
+            std::memcpy(local, b, n);
+            local[n] = 0;
+        }
+        else {
+            copy.assign(b, e);
+            p = copy.c_str();
+        }
+
+        char* q = nullptr;
+        errno = 0;
+        v = strto_float(p, &q, F{});
+        if (q==p+n) {
+            return !(errno==ERANGE && (v==std::numeric_limits<F>::infinity() || v==-std::numeric_limits<F>::infinity()));
+        }
+
+        std::istringstream stream(std::string(b, e));
+        stream.imbue(std::locale::classic());
+        return stream >> v && stream.peek()==EOF;
+    }
+#endif
+
+    template <typename V>
+    struct is_char_type: std::integral_constant<bool,
+        std::is_same<V, char>::value ||
+        std::is_same<V, signed char>::value ||
+        std::is_same<V, unsigned char>::value> {};
+
+    template <typename V>
+    struct is_integer_type: std::integral_constant<bool,
+        std::is_integral<V>::value &&
+        !std::is_same<V, bool>::value &&
+        !is_char_type<V>::value> {};
+
+    // Parsers for which a range [b, e) can be supplied directly.
+    template <typename P, typename = void>
+    struct is_range_parser: std::false_type {};
+
+    template <typename P>
+    struct is_range_parser<P, decltype(void(std::declval<const P&>()(std::declval<const char*>(), std::declval<const char*>())))>:
+        std::true_type {};
+
+    // Parsers that can parse text or a range [b, e) into an existing V.
+    template <typename P, typename V, typename = void>
+    struct has_parse_into: std::false_type {};
+
+    template <typename P, typename V>
+    struct has_parse_into<P, V, decltype(void(std::declval<const P&>().parse_into(std::declval<const char*>(), std::declval<V&>())))>:
+        std::true_type {};
+
+    template <typename P, typename V, typename = void>
+    struct has_range_parse_into: std::false_type {};
+
+    template <typename P, typename V>
+    struct has_range_parse_into<P, V, decltype(void(std::declval<const P&>().parse_into(std::declval<const char*>(), std::declval<const char*>(), std::declval<V&>())))>:
+        std::true_type {};
+}
+
+template <typename V, typename = void>
 struct default_parser {
     maybe<V> operator()(const char* text) const {
         if (!text) return nothing;
@@ -268,6 +601,64 @@ struct default_parser {
     }
 };
 
+template <typename V>
+struct default_parser<V, std::enable_if_t<impl::is_integer_type<V>::value>> {
+    maybe<V> operator()(const char* text) const {
+        return text? (*this)(text, text+std::strlen(text)): nothing;
+    }
+
+    maybe<V> operator()(const char* b, const char* e) const {
+        V v;
+        const char* p = impl::scan_integer(impl::skip_space(b, e), e, v);
+        return p && impl::skip_space(p, e)==e? maybe<V>(v): nothing;
+    }
+};
+
+template <typename V>
+struct default_parser<V, std::enable_if_t<std::is_floating_point<V>::value>> {
+    maybe<V> operator()(const char* text) const {
+        return text? (*this)(text, text+std::strlen(text)): nothing;
+    }
+
+    maybe<V> operator()(const char* b, const char* e) const {
+        b = impl::skip_space(b, e);
+        const char* p = impl::scan_float_syntax(b, e);
+        if (!p || impl::skip_space(p, e)!=e) return nothing;
+
+        V v;
+        return impl::convert_float(b, p, v)? maybe<V>(v): nothing;
+    }
+};
+
+// Characters are read as a single non-space character;
+// booleans as an integer value of 0 or 1.
+
+template <typename V>
+struct default_parser<V, std::enable_if_t<impl::is_char_type<V>::value>> {
+    maybe<V> operator()(const char* text) const {
+        return text? (*this)(text, text+std::strlen(text)): nothing;
+    }
+
+    maybe<V> operator()(const char* b, const char* e) const {
+        b = impl::skip_space(b, e);
+        if (b==e || impl::skip_space(b+1, e)!=e) return nothing;
+        return static_cast<V>(*b);
+    }
+};
+
+template <>
+struct default_parser<bool> {
+    maybe<bool> operator()(const char* text) const {
+        return text? (*this)(text, text+std::strlen(text)): nothing;
+    }
+
+    maybe<bool> operator()(const char* b, const char* e) const {
+        long v;
+        const char* p = impl::scan_integer(impl::skip_space(b, e), e, v);
+        return p && impl::skip_space(p, e)==e && (v==0 || v==1)? maybe<bool>(v==1): nothing;
+    }
+};
+
 template <>
 struct default_parser<const char*> {
     maybe<const char*> operator()(const char* text) const {
@@ -280,7 +671,38 @@ struct default_parser<std::string> {
     maybe<std::string> operator()(const char* text) const {
         return just(std::string(text));
     }
+
+    maybe<std::string> operator()(const char* b, const char* e) const {
+        return just(std::string(b, e));
+    }
+
+    bool parse_into(const char* text, std::string& out) const {
+        if (!text) return false;
+        out.assign(text);
+        return true;
+    }
+
+    bool parse_into(const char* b, const char* e, std::string& out) const {
+        out.assign(b, e);
+        return true;
+    }
+};
+
+#if __cplusplus>=201703
+// Views refer directly to the argument text, which for arguments taken
+// from argv remains valid for the lifetime of the program.
+template <>
+struct default_parser<std::string_view> {
+    maybe<std::string_view> operator()(const char* text) const {
+        if (!text) return nothing;
+        return just(std::string_view(text));
+    }
+
+    maybe<std::string_view> operator()(const char* b, const char* e) const {
+        return just(std::string_view(b, e-b));
+    }
 };
+#endif
 
 template <>
 struct default_parser<void> {
@@ -289,27 +711,122 @@ struct default_parser<void> {
     }
 };
 
+namespace impl {
+    // FNV-1a hash of a NUL-terminated string; also returns its length.
+    constexpr std::size_t hash_cstr(const char* s, std::size_t& n) {
+        std::uint64_t h = 0xcbf29ce484222325ull;
+        const char* p = s;
+        for (; *p; ++p) h = (h^static_cast<unsigned char>(*p))*0x100000001b3ull;
+        n = p-s;
+        return static_cast<std::size_t>(h);
+    }
+
+    constexpr std::uint64_t fnv1a64(const char* s, std::size_t n) {
+        std::uint64_t h = 0xcbf29ce484222325ull;
+        for (std::size_t i = 0; i<n; ++i) h = (h^static_cast<unsigned char>(s[i]))*0x100000001b3ull;
+        return h;
+    }
+
+    constexpr std::size_t hash_bytes(const char* s, std::size_t n) {
+        return static_cast<std::size_t>(fnv1a64(s, n));
+    }
+
+    constexpr std::size_t cstr_length(const char* s) {
+        std::size_t n = 0;
+        while (s[n]) ++n;
+        return n;
+    }
+
+    constexpr bool equal_bytes(const char* a, const char* b, std::size_t n) {
+        for (std::size_t i = 0; i<n; ++i) if (a[i]!=b[i]) return false;
+        return true;
+    }
+
+    constexpr std::size_t pow2_ceil(std::size_t n) {
+        std::size_t p = 1;
+        while (p<n) p *= 2;
+        return p;
+    }
+}
+
+// Keyword tables with more than linear_max entries (by default) are
+// indexed by an open-addressed hash table at construction; smaller tables
+// are searched linearly. Either way, the first entry with a matching key
+// determines the value.
+
 template <typename V>
 class keyword_parser {
     std::vector<std::pair<std::string, V>> map_;
+    std::vector<std::size_t> index_; // 0 => empty slot, else 1+position in map_.
+
+    void build_index() {
+        std::size_t n_slot = 1;
+        while (n_slot<2*map_.size()) n_slot *= 2;
+        index_.assign(n_slot, 0);
+
+        for (std::size_t i = 0; i<map_.size(); ++i) {
+            const std::string& k = map_[i].first;
+            std::size_t j = impl::hash_bytes(k.data(), k.size())&(n_slot-1);
+            for (; index_[j]; j = (j+1)&(n_slot-1)) {
+                if (map_[index_[j]-1].first==k) goto next;
+            }
+            index_[j] = 1+i;
+        next: ;
+        }
+    }
 
 public:
+    static constexpr std::size_t linear_max = 4;
+
     template <typename KeywordPairs>
-    keyword_parser(const KeywordPairs& pairs) {
+    keyword_parser(const KeywordPairs& pairs, std::size_t max_linear = linear_max) {
         using std::begin;
         using std::end;
         map_.assign(begin(pairs), end(pairs));
+        if (map_.size()>max_linear) build_index();
     }
 
     maybe<V> operator()(const char* text) const {
         if (!text) return nothing;
-        for (const auto& p: map_) {
-            if (text==p.first) return p.second;
+        if (index_.empty()) return (*this)(text, text+std::strlen(text));
+
+        std::size_t n = 0;
+        std::size_t h = impl::hash_cstr(text, n);
+        return find(text, n, h);
+    }
+
+    maybe<V> operator()(const char* b, const char* e) const {
+        std::size_t n = e-b;
+        if (index_.empty()) {
+            for (const auto& p: map_) {
+                if (p.first.size()==n && !std::memcmp(p.first.data(), b, n)) return p.second;
+            }
+            return nothing;
+        }
+
+        return find(b, n, impl::hash_bytes(b, n));
+    }
+
+#if __cplusplus>=201703
+    maybe<V> operator()(std::string_view text) const {
+        return (*this)(text.data(), text.data()+text.size());
+    }
+#endif
+
+private:
+    maybe<V> find(const char* text, std::size_t n, std::size_t hash) const {
+        std::size_t mask = index_.size()-1;
+        for (std::size_t j = hash&mask; index_[j]; j = (j+1)&mask) {
+            const auto& p = map_[index_[j]-1];
+            if (p.first.size()==n && !std::memcmp(p.first.data(), text, n)) return p.second;
         }
         return nothing;
     }
 };
 
+template <typename V>
+constexpr std::size_t keyword_parser<V>::linear_max;
+
 // Returns a parser that matches a set of keywords,
 // returning the corresponding values in the supplied
 // pairs.
@@ -321,70 +838,1432 @@ auto keywords(const KeywordPairs& pairs) {
     return keyword_parser<value_type>(pairs);
 }
 
+// Compile-time keyword tables
+//
+// A static_keyword_parser<V, N> holds a copy of N keyword_entry<V> values
+// together with a hash index over their keys, computed by a constexpr
+// constructor. It performs no allocation, can be declared constexpr when
+// V is a literal type, and matches with the same first-match semantics as
+// keyword_parser. Keys are not copied: they must outlive the parser, as
+// string literals do.
+//
+// keywords() returns a static_keyword_parser when given an array of
+// keyword_entry<V>:
+//
+//     constexpr to::keyword_entry<int> fns[] = { {"one", 1}, {"two", 2} };
+//     constexpr auto fn_parser = to::keywords(fns);
 
-// A parser for delimited sequences of values; returns
-// a vector of the values obtained from the supplied
-// per-item parser.
+template <typename V>
+struct keyword_entry {
+    const char* key;
+    std::size_t length;
+    std::size_t hash;
+    V value;
+
+    constexpr keyword_entry(const char* key, V value):
+        key(key), length(impl::cstr_length(key)), hash(impl::hash_bytes(key, length)), value(std::move(value))
+    {}
+};
 
-template <typename P>
-class delimited_parser {
-    char delim_;
-    P parse_;
-    using inner_value_type = std::decay_t<decltype(*std::declval<P>()(""))>;
+template <typename V, std::size_t N>
+class static_keyword_parser {
+    static constexpr std::size_t n_slot = impl::pow2_ceil(2*N);
+
+    keyword_entry<V> entries_[N];
+    std::size_t index_[n_slot]; // 0 => empty slot, else 1+position in entries_.
+
+    template <std::size_t... I>
+    constexpr static_keyword_parser(const keyword_entry<V> (&table)[N], std::index_sequence<I...>):
+        entries_{table[I]...}, index_{}
+    {
+        for (std::size_t i = 0; i<N; ++i) {
+            const auto& e = entries_[i];
+            std::size_t j = e.hash&(n_slot-1);
+            bool dup = false;
+            for (; index_[j] && !dup; j = (j+1)&(n_slot-1)) {
+                const auto& f = entries_[index_[j]-1];
+                dup = f.length==e.length && impl::equal_bytes(f.key, e.key, e.length);
+            }
+            if (!dup) index_[j] = 1+i;
+        }
+    }
 
 public:
-    template <typename Q>
-    delimited_parser(char delim, Q&& parse): delim_(delim), parse_(std::forward<Q>(parse)) {}
+    constexpr static_keyword_parser(const keyword_entry<V> (&table)[N]):
+        static_keyword_parser(table, std::make_index_sequence<N>{})
+    {}
 
-    maybe<std::vector<inner_value_type>> operator()(const char* text) const {
+    maybe<V> operator()(const char* text) const {
         if (!text) return nothing;
 
-        std::vector<inner_value_type> values;
-        if (!*text) return values;
+        std::size_t n = 0;
+        std::size_t h = impl::hash_cstr(text, n);
+        return find(text, n, h);
+    }
+
+    maybe<V> operator()(const char* b, const char* e) const {
+        return find(b, e-b, impl::hash_bytes(b, e-b));
+    }
+
+#if __cplusplus>=201703
+    maybe<V> operator()(std::string_view text) const {
+        return (*this)(text.data(), text.data()+text.size());
+    }
+#endif
 
-        std::size_t n = std::strlen(text);
-        std::vector<char> input(1+n);
-        std::copy(text, text+n, input.data());
+private:
+    maybe<V> find(const char* text, std::size_t n, std::size_t hash) const {
+        for (std::size_t j = hash&(n_slot-1); index_[j]; j = (j+1)&(n_slot-1)) {
+            const auto& e = entries_[index_[j]-1];
+            if (e.length==n && !std::memcmp(e.key, text, n)) return e.value;
+        }
+        return nothing;
+    }
+};
+
+template <typename V, std::size_t N>
+constexpr auto keywords(const keyword_entry<V> (&table)[N]) {
+    return static_keyword_parser<V, N>(table);
+}
 
-        char* p = input.data();
-        char* end = input.data()+1+n;
-        do {
-            char* q = p;
-            while (*q && *q!=delim_) ++q;
-            *q++ = 0;
 
-            if (auto mv = parse_(p)) values.push_back(*mv);
-            else return nothing;
+namespace impl {
+    template <typename P>
+    struct is_default_integer_parser: std::false_type {};
 
-            p = q;
-        } while (p<end);
+    template <typename V>
+    struct is_default_integer_parser<default_parser<V>>: is_integer_type<V> {};
 
-        return values;
+    inline bool delimits_integers(char c) {
+        return !is_digit(c) && !is_space(c) && c!='+' && c!='-';
     }
-};
 
-// Convenience constructors for delimited parser.
+    // Position of the first delim in [p, end), or end.
+    inline const char* find_delim(const char* p, const char* end, char delim) {
+        auto q = static_cast<const char*>(std::memchr(p, delim, end-p));
+        return q? q: end;
+    }
 
-template <typename Q>
-auto delimited(char delim, Q&& parse) {
-    using P = std::decay_t<Q>;
-    return delimited_parser<P>(delim, std::forward<Q>(parse));
-}
+    // Apply the parser to [b, e) directly if it is a range parser,
+    // or else to a NUL-terminated copy in buf.
+    template <typename P, std::enable_if_t<is_range_parser<P>::value, int> = 0>
+    auto parse_range(const P& parse, const char* b, const char* e, std::string&) {
+        return parse(b, e);
+    }
 
-template <typename V>
-auto delimited(char delim = ',') {
-    return delimited(delim, default_parser<V>{});
-}
+    template <typename P, std::enable_if_t<!is_range_parser<P>::value, int> = 0>
+    auto parse_range(const P& parse, const char* b, const char* e, std::string& buf) {
+        buf.assign(b, e);
+        return parse(buf.c_str());
+    }
 
-// Option keys
-// -----------
-//
-// A key is how the option is specified in an argument list, and is typically
-// represented as a 'short' (e.g. '-a') option or a 'long' option (e.g.
-// '--apple').
-//
-// The value for an option can always be taken from the next argument in the
-// list, but in addition can be specified together with the key itself,
+    // Make an action that parses text into var. If the parser supports
+    // parse_into, the value is built in a scratch value that is swapped
+    // with var on success, so that var is left unchanged on failure and
+    // its old storage is reused by the next parse.
+    template <typename V, typename P,
+        std::enable_if_t<has_parse_into<P, V>::value && std::is_default_constructible<V>::value, int> = 0>
+    auto parse_into_action(V& var, P parse) {
+        return [ref = std::ref(var), parse = std::move(parse), scratch = V{}](const char* text) mutable {
+            if (!parse.parse_into(text, scratch)) return false;
+
+            using std::swap;
+            swap(scratch, ref.get());
+            return true;
+        };
+    }
+
+    template <typename V, typename P,
+        std::enable_if_t<!(has_parse_into<P, V>::value && std::is_default_constructible<V>::value), int> = 0>
+    auto parse_into_action(V& var, P parse) {
+        return [ref = std::ref(var), parse = std::move(parse)](const char* text) {
+            if (auto v = parse(text)) return ref.get() = std::move(*v), true;
+            else return false;
+        };
+    }
+
+    // Parse [b, e) into out, in place if the parser supports parse_into,
+    // using buf for a NUL-terminated copy if required.
+    template <typename P, typename V, std::enable_if_t<has_range_parse_into<P, V>::value, int> = 0>
+    bool parse_range_into(const P& parse, const char* b, const char* e, std::string&, V& out) {
+        return parse.parse_into(b, e, out);
+    }
+
+    template <typename P, typename V, std::enable_if_t<!has_range_parse_into<P, V>::value && has_parse_into<P, V>::value, int> = 0>
+    bool parse_range_into(const P& parse, const char* b, const char* e, std::string& buf, V& out) {
+        buf.assign(b, e);
+        return parse.parse_into(buf.c_str(), out);
+    }
+
+    template <typename P, typename V, std::enable_if_t<!has_range_parse_into<P, V>::value && !has_parse_into<P, V>::value, int> = 0>
+    bool parse_range_into(const P& parse, const char* b, const char* e, std::string& buf, V& out) {
+        if (auto v = parse_range(parse, b, e, buf)) return out = std::move(*v), true;
+        else return false;
+    }
+}
+
+// A parser for delimited sequences of values; returns
+// a vector of the values obtained from the supplied
+// per-item parser.
+//
+// Elements are handed to the per-item parser in place as a range
+// [b, e) if it supports that; otherwise each element is copied
+// into a reusable NUL-terminated buffer.
+//
+// The for_each() and copy() methods instead pass each value to a callback
+// or through an output iterator as it is parsed, without collecting them
+// in a vector. They stop at the first element that fails to parse; if
+// validate is true, the sequence is first parsed in full without storing
+// the values, and no values are passed on if any element fails; each
+// element is then parsed twice.
+// for_each() also accepts a range [b, e) in place of a NUL-terminated string.
+//
+// parse_into() parses into an existing vector, reusing its capacity. If
+// the per-item parser supports parse_into, existing elements are reused
+// as well, so that e.g. a vector of strings keeps their buffers.
+
+template <typename P>
+class delimited_parser {
+    char delim_;
+    P parse_;
+    using inner_value_type = std::decay_t<decltype(*std::declval<P>()(""))>;
+
+    template <typename F>
+    bool each_(const char* text, const char* end, F& f) const {
+        return each_(text, end, f, impl::is_default_integer_parser<P>{});
+    }
+
+    // Integer elements parsed with the default parser are scanned in
+    // the same pass that finds the delimiters, provided the delimiter
+    // cannot itself be part of an element.
+    template <typename F>
+    bool each_(const char* text, const char* end, F& f, std::true_type) const {
+        if (!impl::delimits_integers(delim_)) return each_(text, end, f, std::false_type{});
+        if (text==end) return true;
+
+        for (const char* p = text;; ++p) {
+            inner_value_type v;
+            if (!(p = impl::scan_integer(impl::skip_space(p, end), end, v))) return false;
+
+            p = impl::skip_space(p, end);
+            if (p!=end && *p!=delim_) return false;
+
+            f(std::move(v));
+            if (p==end) return true;
+        }
+    }
+
+    template <typename F>
+    bool each_(const char* text, const char* end, F& f, std::false_type) const {
+        if (text==end) return true;
+
+        std::string buf;
+        for (const char* p = text;; ++p) {
+            const char* q = impl::find_delim(p, end, delim_);
+            if (auto mv = impl::parse_range(parse_, p, q, buf)) f(*std::move(mv));
+            else return false;
+
+            if ((p = q)==end) return true;
+        }
+    }
+
+    using elementwise = std::integral_constant<bool,
+        std::is_default_constructible<inner_value_type>::value &&
+        (impl::has_parse_into<P, inner_value_type>::value || impl::has_range_parse_into<P, inner_value_type>::value)>;
+
+    bool into_(const char* text, const char* end, std::vector<inner_value_type>& out, std::false_type) const {
+        out.clear();
+        if (text==end) return true;
+
+        out.reserve(1+std::count(text, end, delim_));
+        auto push = [&out](inner_value_type&& v) { out.push_back(std::move(v)); };
+        return each_(text, end, push);
+    }
+
+    bool into_(const char* text, const char* end, std::vector<inner_value_type>& out, std::true_type) const {
+        std::size_t n = 0;
+        if (text!=end) {
+            out.reserve(1+std::count(text, end, delim_));
+
+            std::string buf;
+            for (const char* p = text;; ++p) {
+                const char* q = impl::find_delim(p, end, delim_);
+                if (n==out.size()) out.emplace_back();
+                if (!impl::parse_range_into(parse_, p, q, buf, out[n++])) return false;
+
+                if ((p = q)==end) break;
+            }
+        }
+        out.erase(out.begin()+n, out.end());
+        return true;
+    }
+
+public:
+    template <typename Q>
+    delimited_parser(char delim, Q&& parse): delim_(delim), parse_(std::forward<Q>(parse)) {}
+
+    char delimiter() const { return delim_; }
+
+    maybe<std::vector<inner_value_type>> operator()(const char* text) const {
+        std::vector<inner_value_type> values;
+        if (parse_into(text, values)) return values;
+        else return nothing;
+    }
+
+    bool parse_into(const char* text, std::vector<inner_value_type>& out) const {
+        if (!text) return false;
+        return into_(text, text+std::strlen(text), out, elementwise{});
+    }
+
+    template <typename F>
+    bool for_each(const char* text, F&& f, bool validate = false) const {
+        if (!text) return false;
+
+        const char* end = text+std::strlen(text);
+        if (validate) {
+            auto ignore = [](inner_value_type&&) {};
+            if (!each_(text, end, ignore)) return false;
+        }
+        return each_(text, end, f);
+    }
+
+    // Parse the (not necessarily NUL-terminated) range [b, e).
+    template <typename F>
+    bool for_each(const char* b, const char* e, F&& f) const {
+        return each_(b, e, f);
+    }
+
+    template <typename OutIter>
+    maybe<OutIter> copy(const char* text, OutIter out, bool validate = false) const {
+        auto emit = [&out](inner_value_type&& v) { *out++ = std::move(v); };
+        if (for_each(text, emit, validate)) return out;
+        else return nothing;
+    }
+};
+
+// Convenience constructors for delimited parser.
+
+template <typename Q>
+auto delimited(char delim, Q&& parse) {
+    using P = std::decay_t<Q>;
+    return delimited_parser<P>(delim, std::forward<Q>(parse));
+}
+
+template <typename V>
+auto delimited(char delim = ',') {
+    return delimited(delim, default_parser<V>{});
+}
+
+// Fixed-arity sequences
+//
+// A tuple_parser<P...> parses exactly sizeof...(P) delimited elements,
+// the i-th with the i-th parser, into a std::tuple. An array_parser<P, N>
+// parses exactly N delimited elements with the one parser into a
+// std::array. Elements are passed to the element parsers as for
+// delimited_parser, and an argument with the wrong number of elements
+// is rejected before any element is parsed. No heap allocation is
+// performed beyond what the element parsers do themselves.
+
+namespace impl {
+    template <typename P>
+    using parsed_type = std::decay_t<decltype(*std::declval<P>()(""))>;
+
+    // Split [text, end) at delim into exactly N ranges, recorded in
+    // bounds[0..N]; the i-th range is [bounds[i]+(i>0), bounds[i+1]).
+    template <std::size_t N>
+    bool split_exact(const char* text, const char* end, char delim, const char* (&bounds)[N+1]) {
+        if (static_cast<std::size_t>(std::count(text, end, delim))!=N-1) return false;
+
+        bounds[0] = text;
+        for (std::size_t i = 1; i<N; ++i) bounds[i] = find_delim(bounds[i-1]+(i>1), end, delim);
+        bounds[N] = end;
+        return true;
+    }
+}
+
+template <typename... P>
+class tuple_parser {
+    static constexpr std::size_t N = sizeof...(P);
+    static_assert(N>0, "tuple_parser requires at least one element parser");
+
+    char delim_;
+    std::tuple<P...> parse_;
+
+    template <std::size_t... I>
+    maybe<std::tuple<impl::parsed_type<P>...>> parse(const char* (&bounds)[N+1], std::index_sequence<I...>) const {
+        std::string buf;
+        std::tuple<maybe<impl::parsed_type<P>>...> items;
+
+        bool ok = true;
+        (void)std::initializer_list<int>{
+            (ok = ok && (std::get<I>(items) = impl::parse_range(std::get<I>(parse_), bounds[I]+(I>0), bounds[I+1], buf)), 0)...
+        };
+
+        if (!ok) return nothing;
+        return std::tuple<impl::parsed_type<P>...>(*std::move(std::get<I>(items))...);
+    }
+
+public:
+    template <typename... Q>
+    tuple_parser(char delim, Q&&... parse): delim_(delim), parse_(std::forward<Q>(parse)...) {}
+
+    maybe<std::tuple<impl::parsed_type<P>...>> operator()(const char* text) const {
+        if (!text) return nothing;
+
+        const char* bounds[N+1];
+        if (!impl::split_exact<N>(text, text+std::strlen(text), delim_, bounds)) return nothing;
+        return parse(bounds, std::make_index_sequence<N>{});
+    }
+};
+
+template <typename P, std::size_t N>
+class array_parser {
+    static_assert(N>0, "array_parser requires at least one element");
+    using value_type = impl::parsed_type<P>;
+
+    char delim_;
+    P parse_;
+
+    template <std::size_t... I>
+    maybe<std::array<value_type, N>> parse(const char* (&bounds)[N+1], std::index_sequence<I...>) const {
+        std::string buf;
+        maybe<value_type> items[N];
+
+        for (std::size_t i = 0; i<N; ++i) {
+            if (!(items[i] = impl::parse_range(parse_, bounds[i]+(i>0), bounds[i+1], buf))) return nothing;
+        }
+        return std::array<value_type, N>{{*std::move(items[I])...}};
+    }
+
+public:
+    template <typename Q>
+    array_parser(char delim, Q&& parse): delim_(delim), parse_(std::forward<Q>(parse)) {}
+
+    maybe<std::array<value_type, N>> operator()(const char* text) const {
+        if (!text) return nothing;
+
+        const char* bounds[N+1];
+        if (!impl::split_exact<N>(text, text+std::strlen(text), delim_, bounds)) return nothing;
+        return parse(bounds, std::make_index_sequence<N>{});
+    }
+};
+
+// Convenience constructors for tuple and array parsers.
+
+template <typename... Q>
+auto tuple_of(char delim, Q&&... parse) {
+    return tuple_parser<std::decay_t<Q>...>(delim, std::forward<Q>(parse)...);
+}
+
+template <typename... V>
+auto tuple_of(char delim = ',') {
+    return tuple_of(delim, default_parser<V>{}...);
+}
+
+template <std::size_t N, typename Q>
+auto array_of(char delim, Q&& parse) {
+    return array_parser<std::decay_t<Q>, N>(delim, std::forward<Q>(parse));
+}
+
+template <typename V, std::size_t N>
+auto array_of(char delim = ',') {
+    return array_of<N>(delim, default_parser<V>{});
+}
+
+// Parser combinators
+//
+// These build new parsers from existing ones. Each yields a concrete
+// parser type rather than a type-erased function, so that the wrapped
+// parsers can be inlined into the combination, and each provides a range
+// overload when the parsers it wraps do.
+//
+//     p | q                   Try p, and then q if p fails. Both must
+//                             parse the same value type.
+//     transform(p, f)         Apply f to the value parsed by p.
+//     validate(p, pred)       Accept the value v parsed by p only if pred(v).
+//     in_range(p, lo, hi)     Accept the value v parsed by p only if
+//                             lo <= v <= hi.
+//     optional(p)             Parse an empty argument as an empty maybe<V>,
+//                             and otherwise parse with p, giving a maybe<V>.
+//     optional(p, v)          Parse an empty argument as v, and otherwise
+//                             parse with p.
+//     sequence(delim, p...)   Equivalent to tuple_of(delim, p...).
+
+namespace impl {
+    template <typename P, typename = void>
+    struct is_parser: std::false_type {};
+
+    template <typename P>
+    struct is_parser<P, std::enable_if_t<is_maybe<decltype(std::declval<const P&>()(std::declval<const char*>()))>::value>>:
+        std::true_type {};
+
+    // Prevents deduction of V from a function argument.
+    template <typename V>
+    using identity_t = typename std::enable_if<true, V>::type;
+
+    template <typename V>
+    struct closed_interval {
+        V lo, hi;
+        bool operator()(const V& v) const { return !(v<lo) && !(hi<v); }
+    };
+}
+
+template <typename P, typename Q>
+class alternative_parser {
+    P p_;
+    Q q_;
+
+public:
+    using value_type = impl::parsed_type<P>;
+    static_assert(std::is_same<value_type, impl::parsed_type<Q>>::value, "alternative parsers must have the same value type");
+
+    alternative_parser(P p, Q q): p_(std::move(p)), q_(std::move(q)) {}
+
+    maybe<value_type> operator()(const char* text) const {
+        if (auto v = p_(text)) return v;
+        return q_(text);
+    }
+
+    template <typename P_ = P, typename Q_ = Q,
+        std::enable_if_t<impl::is_range_parser<P_>::value && impl::is_range_parser<Q_>::value, int> = 0>
+    maybe<value_type> operator()(const char* b, const char* e) const {
+        if (auto v = p_(b, e)) return v;
+        return q_(b, e);
+    }
+};
+
+template <typename P, typename Q,
+    std::enable_if_t<impl::is_parser<P>::value && impl::is_parser<Q>::value, int> = 0>
+alternative_parser<P, Q> operator|(P p, Q q) {
+    return alternative_parser<P, Q>(std::move(p), std::move(q));
+}
+
+template <typename P, typename F>
+class transform_parser {
+    P p_;
+    F f_;
+
+    template <typename M>
+    auto apply(M&& m) const -> maybe<std::decay_t<decltype(f_(*std::forward<M>(m)))>> {
+        if (m) return f_(*std::forward<M>(m));
+        else return nothing;
+    }
+
+public:
+    transform_parser(P p, F f): p_(std::move(p)), f_(std::move(f)) {}
+
+    auto operator()(const char* text) const { return apply(p_(text)); }
+
+    template <typename P_ = P, std::enable_if_t<impl::is_range_parser<P_>::value, int> = 0>
+    auto operator()(const char* b, const char* e) const { return apply(p_(b, e)); }
+};
+
+template <typename P, typename F>
+transform_parser<std::decay_t<P>, std::decay_t<F>> transform(P&& p, F&& f) {
+    return {std::forward<P>(p), std::forward<F>(f)};
+}
+
+template <typename P, typename Pred>
+class validate_parser {
+    P p_;
+    Pred pred_;
+
+public:
+    using value_type = impl::parsed_type<P>;
+
+    validate_parser(P p, Pred pred): p_(std::move(p)), pred_(std::move(pred)) {}
+
+    maybe<value_type> operator()(const char* text) const {
+        auto v = p_(text);
+        if (v && pred_(*v)) return v;
+        return nothing;
+    }
+
+    template <typename P_ = P, std::enable_if_t<impl::is_range_parser<P_>::value, int> = 0>
+    maybe<value_type> operator()(const char* b, const char* e) const {
+        auto v = p_(b, e);
+        if (v && pred_(*v)) return v;
+        return nothing;
+    }
+};
+
+template <typename P, typename Pred>
+validate_parser<std::decay_t<P>, std::decay_t<Pred>> validate(P&& p, Pred&& pred) {
+    return {std::forward<P>(p), std::forward<Pred>(pred)};
+}
+
+template <typename P, typename V = impl::parsed_type<std::decay_t<P>>>
+validate_parser<std::decay_t<P>, impl::closed_interval<V>> in_range(P&& p, impl::identity_t<V> lo, impl::identity_t<V> hi) {
+    return {std::forward<P>(p), impl::closed_interval<V>{std::move(lo), std::move(hi)}};
+}
+
+template <typename P>
+class optional_parser {
+    P p_;
+
+public:
+    using value_type = maybe<impl::parsed_type<P>>;
+
+    explicit optional_parser(P p): p_(std::move(p)) {}
+
+    maybe<value_type> operator()(const char* text) const {
+        if (!text) return nothing;
+        if (!*text) return just(value_type{});
+        if (auto v = p_(text)) return just(value_type(std::move(v)));
+        return nothing;
+    }
+
+    template <typename P_ = P, std::enable_if_t<impl::is_range_parser<P_>::value, int> = 0>
+    maybe<value_type> operator()(const char* b, const char* e) const {
+        if (b==e) return just(value_type{});
+        if (auto v = p_(b, e)) return just(value_type(std::move(v)));
+        return nothing;
+    }
+};
+
+namespace impl {
+    template <typename V>
+    struct value_or {
+        V fallback;
+        V operator()(const maybe<V>& v) const { return v? *v: fallback; }
+    };
+}
+
+template <typename P>
+optional_parser<std::decay_t<P>> optional(P&& p) {
+    return optional_parser<std::decay_t<P>>(std::forward<P>(p));
+}
+
+template <typename P, typename V = impl::parsed_type<std::decay_t<P>>>
+auto optional(P&& p, impl::identity_t<V> fallback) {
+    return transform(optional(std::forward<P>(p)), impl::value_or<V>{std::move(fallback)});
+}
+
+template <typename Q, typename... R>
+auto sequence(char delim, Q&& parse, R&&... rest) {
+    return tuple_of(delim, std::forward<Q>(parse), std::forward<R>(rest)...);
+}
+
+// Memoization
+//
+// memoize(p, capacity) wraps the parser p with a cache of the results of
+// the most recently used distinct arguments, up to capacity entries, so
+// that an expensive parser runs once per distinct argument text. Failed
+// parses are cached too. Values that refer to the text of their argument,
+// such as a std::string_view, refer to the cached copy of that text, and
+// remain valid only until the entry is evicted or the cache is cleared.
+// Copies of a memo_parser, such as those held by sinks, share the one
+// cache and its hit and miss counts. The cache is
+// not synchronized: a memo_parser must not be used concurrently from
+// multiple threads.
+
+template <typename P>
+class memo_parser {
+public:
+    using value_type = impl::parsed_type<P>;
+
+    memo_parser(P p, std::size_t capacity):
+        parse_(std::move(p)), cache_(std::make_shared<cache>())
+    {
+        cache_->capacity = capacity? capacity: 1;
+    }
+
+    maybe<value_type> operator()(const char* text) const {
+        if (!text) return nothing;
+
+        std::size_t n = 0;
+        std::size_t h = impl::hash_cstr(text, n);
+        return lookup(text, n, h);
+    }
+
+    maybe<value_type> operator()(const char* b, const char* e) const {
+        return lookup(b, e-b, impl::hash_bytes(b, e-b));
+    }
+
+    std::size_t hits() const { return cache_->hits; }
+    std::size_t misses() const { return cache_->misses; }
+    std::size_t size() const { return cache_->entries.size(); }
+    std::size_t capacity() const { return cache_->capacity; }
+
+    void clear() {
+        cache_->entries.clear();
+        cache_->index.clear();
+        cache_->hits = cache_->misses = 0;
+    }
+
+private:
+    struct entry {
+        std::string text;
+        std::size_t hash;
+        maybe<value_type> value;
+    };
+
+    // Entries are kept in order of most recent use; index maps the hash
+    // of each entry's text to its position.
+    struct cache {
+        std::list<entry> entries;
+        std::unordered_multimap<std::size_t, typename std::list<entry>::iterator> index;
+        std::size_t capacity = 0, hits = 0, misses = 0;
+    };
+
+    P parse_;
+    std::shared_ptr<cache> cache_;
+
+    maybe<value_type> lookup(const char* text, std::size_t n, std::size_t h) const {
+        cache& c = *cache_;
+
+        auto range = c.index.equal_range(h);
+        for (auto i = range.first; i!=range.second; ++i) {
+            auto& e = *i->second;
+            if (e.text.size()==n && !std::memcmp(e.text.data(), text, n)) {
+                ++c.hits;
+                c.entries.splice(c.entries.begin(), c.entries, i->second);
+                return e.value;
+            }
+        }
+
+        // Parse from the entry's own copy of the text, so that values which
+        // refer to their argument, such as string views, remain valid.
+        ++c.misses;
+        if (c.entries.size()==c.capacity) evict();
+        c.entries.push_front(entry{std::string(text, n), h, nothing});
+
+        auto& e = c.entries.front();
+        try {
+            e.value = parse_(e.text.c_str());
+        }
+        catch (...) {
+            c.entries.pop_front();
+            throw;
+        }
+        c.index.emplace(h, c.entries.begin());
+        return e.value;
+    }
+
+    void evict() const {
+        cache& c = *cache_;
+        auto last = std::prev(c.entries.end());
+
+        auto range = c.index.equal_range(last->hash);
+        for (auto i = range.first; i!=range.second; ++i) {
+            if (i->second==last) {
+                c.index.erase(i);
+                break;
+            }
+        }
+        c.entries.pop_back();
+    }
+};
+
+template <typename P>
+memo_parser<std::decay_t<P>> memoize(P&& p, std::size_t capacity = 256) {
+    return memo_parser<std::decay_t<P>>(std::forward<P>(p), capacity);
+}
+
+// Nested sequences
+//
+// A nested_parser<P> parses rows separated by one delimiter, each a
+// sequence of elements separated by another, into a ragged_array: the
+// values of all rows in one contiguous vector, together with the offsets
+// at which each row starts (compressed sparse row layout). Rows may be
+// empty. If constructed as rectangular, every row must have the same
+// number of elements.
+
+template <typename V>
+struct ragged_array {
+    using const_iterator = typename std::vector<V>::const_iterator;
+
+    std::vector<V> values;
+    // Row i comprises values[offsets[i]] up to values[offsets[i+1]].
+    std::vector<std::size_t> offsets{0};
+
+    std::size_t rows() const { return offsets.size()-1; }
+    std::size_t row_size(std::size_t i) const { return offsets[i+1]-offsets[i]; }
+
+    const_iterator begin(std::size_t i) const { return values.begin()+offsets[i]; }
+    const_iterator end(std::size_t i) const { return values.begin()+offsets[i+1]; }
+
+    bool rectangular() const {
+        for (std::size_t i = 1; i<rows(); ++i) {
+            if (row_size(i)!=row_size(0)) return false;
+        }
+        return true;
+    }
+};
+
+template <typename P>
+class nested_parser {
+    using value_type = std::decay_t<decltype(*std::declval<P>()(""))>;
+
+    char row_delim_;
+    delimited_parser<P> row_;
+    bool rectangular_;
+
+public:
+    template <typename Q>
+    nested_parser(char row_delim, char delim, Q&& parse, bool rectangular = false):
+        row_delim_(row_delim), row_(delim, std::forward<Q>(parse)), rectangular_(rectangular)
+    {}
+
+    maybe<ragged_array<value_type>> operator()(const char* text) const {
+        ragged_array<value_type> a;
+        if (parse_into(text, a)) return a;
+        else return nothing;
+    }
+
+    bool parse_into(const char* text, ragged_array<value_type>& a) const {
+        if (!text) return false;
+
+        a.values.clear();
+        a.offsets.assign(1, 0);
+        if (!*text) return true;
+
+        const char* end = text+std::strlen(text);
+        std::size_t n_row = 1+std::count(text, end, row_delim_);
+        a.offsets.reserve(n_row+1);
+        a.values.reserve(n_row+std::count(text, end, row_.delimiter()));
+
+        auto push = [&a](value_type&& v) { a.values.push_back(std::move(v)); };
+        for (const char* p = text;; ++p) {
+            const char* q = impl::find_delim(p, end, row_delim_);
+            if (!row_.for_each(p, q, push)) return false;
+
+            a.offsets.push_back(a.values.size());
+            if (rectangular_ && a.row_size(a.rows()-1)!=a.row_size(0)) return false;
+
+            if ((p = q)==end) return true;
+        }
+    }
+};
+
+// Convenience constructors for nested parsers; matrix() requires rows
+// of equal length.
+
+template <typename Q>
+auto nested(char row_delim, char delim, Q&& parse) {
+    return nested_parser<std::decay_t<Q>>(row_delim, delim, std::forward<Q>(parse));
+}
+
+template <typename V>
+auto nested(char row_delim = ';', char delim = ',') {
+    return nested(row_delim, delim, default_parser<V>{});
+}
+
+template <typename Q>
+auto matrix(char row_delim, char delim, Q&& parse) {
+    return nested_parser<std::decay_t<Q>>(row_delim, delim, std::forward<Q>(parse), true);
+}
+
+template <typename V>
+auto matrix(char row_delim = ';', char delim = ',') {
+    return matrix(row_delim, delim, default_parser<V>{});
+}
+
+// Interval sets
+//
+// An interval_set<I> is a union of integer intervals, each with an
+// optional stride, kept as a list of interval descriptors rather than
+// expanded. It supports membership tests and lazy iteration over its
+// elements, in the order the intervals were given.
+//
+// The parser returned by intervals<I>(delim) reads a delimited list
+// of terms, each of which is one of:
+//
+//     a            the single value a
+//     a-b          values a to b inclusive
+//     a-           values from a to the maximum value of I
+//
+// optionally followed by ':s' to take every s-th value. For example,
+// "0-99999:4,200000-" is every fourth value below 100000, and every
+// value from 200000.
+
+template <typename I>
+struct interval {
+    I first, last, stride;
+
+    bool contains(I x) const {
+        using U = std::make_unsigned_t<I>;
+        return x>=first && x<=last && (static_cast<U>(x)-static_cast<U>(first))%static_cast<U>(stride)==0;
+    }
+};
+
+template <typename I>
+class interval_set {
+    std::vector<interval<I>> intervals_;
+
+public:
+    interval_set() = default;
+    explicit interval_set(std::vector<interval<I>> intervals): intervals_(std::move(intervals)) {}
+
+    const std::vector<interval<I>>& intervals() const { return intervals_; }
+    bool empty() const { return intervals_.empty(); }
+
+    bool contains(I x) const {
+        for (auto& iv: intervals_) if (iv.contains(x)) return true;
+        return false;
+    }
+
+    struct iterator {
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = I;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const I*;
+        using reference = const I&;
+
+        iterator() = default;
+        iterator(const interval<I>* i, const interval<I>* end): i_(i), end_(end), v_(i!=end? i->first: I{}) {}
+
+        reference operator*() const { return v_; }
+        pointer operator->() const { return &v_; }
+
+        iterator& operator++() {
+            using U = std::make_unsigned_t<I>;
+            if (static_cast<U>(i_->last)-static_cast<U>(v_)<static_cast<U>(i_->stride)) {
+                if (++i_!=end_) v_ = i_->first;
+            }
+            else {
+                v_ += i_->stride;
+            }
+            return *this;
+        }
+
+        iterator operator++(int) { auto x = *this; return ++*this, x; }
+
+        bool operator==(const iterator& x) const { return i_==x.i_ && (i_==end_ || v_==x.v_); }
+        bool operator!=(const iterator& x) const { return !(*this==x); }
+
+    private:
+        const interval<I>* i_ = nullptr;
+        const interval<I>* end_ = nullptr;
+        I v_ = I{};
+    };
+
+    iterator begin() const { return iterator(intervals_.data(), intervals_.data()+intervals_.size()); }
+    iterator end() const { return iterator(intervals_.data()+intervals_.size(), intervals_.data()+intervals_.size()); }
+};
+
+template <typename I>
+struct interval_parser {
+    maybe<interval<I>> operator()(const char* text) const {
+        return text? (*this)(text, text+std::strlen(text)): nothing;
+    }
+
+    maybe<interval<I>> operator()(const char* b, const char* e) const {
+        interval<I> iv{I{}, I{}, I{1}};
+        const char* p = impl::scan_integer(impl::skip_space(b, e), e, iv.first);
+        if (!p) return nothing;
+
+        iv.last = iv.first;
+        p = impl::skip_space(p, e);
+        if (p!=e && *p=='-') {
+            p = impl::skip_space(p+1, e);
+            if (p==e || *p==':') iv.last = std::numeric_limits<I>::max();
+            else if (!(p = impl::scan_integer(p, e, iv.last))) return nothing;
+            p = impl::skip_space(p, e);
+        }
+
+        if (p!=e && *p==':') {
+            p = impl::scan_integer(impl::skip_space(p+1, e), e, iv.stride);
+            if (!p || iv.stride<=0) return nothing;
+            p = impl::skip_space(p, e);
+        }
+
+        if (p!=e || iv.last<iv.first) return nothing;
+        return iv;
+    }
+};
+
+template <typename I>
+class interval_set_parser {
+    delimited_parser<interval_parser<I>> parse_;
+
+public:
+    explicit interval_set_parser(char delim = ','): parse_(delim, interval_parser<I>{}) {}
+
+    maybe<interval_set<I>> operator()(const char* text) const {
+        if (auto ivs = parse_(text)) return interval_set<I>(*std::move(ivs));
+        else return nothing;
+    }
+};
+
+template <typename I>
+auto intervals(char delim = ',') {
+    return interval_set_parser<I>(delim);
+}
+
+// CPU lists
+//
+// A cpu_set is a dynamically sized bitset of non-negative indices, such as
+// CPU or NUMA node numbers. The parser returned by cpulist() reads the
+// Linux cpulist format, as found in e.g. /sys/devices/system/cpu/online:
+// a comma-separated list of indices and inclusive index ranges, such as
+// "0-3,8-15,32". Indices at or above the parser's limit are rejected.
+
+namespace impl {
+    inline unsigned popcount64(std::uint64_t x) {
+#if defined(__GNUC__)
+        return __builtin_popcountll(x);
+#else
+        unsigned n = 0;
+        for (; x; x &= x-1) ++n;
+        return n;
+#endif
+    }
+
+    // Index of lowest set bit; x must be non-zero.
+    inline unsigned ctz64(std::uint64_t x) {
+#if defined(__GNUC__)
+        return __builtin_ctzll(x);
+#else
+        unsigned n = 0;
+        for (; !(x&1); x >>= 1) ++n;
+        return n;
+#endif
+    }
+}
+
+class cpu_set {
+    std::vector<std::uint64_t> words_;
+
+public:
+    cpu_set() = default;
+
+    void set(std::size_t i) {
+        if (i/64>=words_.size()) words_.resize(i/64+1);
+        words_[i/64] |= std::uint64_t(1)<<(i%64);
+    }
+
+    bool test(std::size_t i) const {
+        return i/64<words_.size() && (words_[i/64]>>(i%64)&1);
+    }
+
+    std::size_t count() const {
+        std::size_t n = 0;
+        for (auto w: words_) n += impl::popcount64(w);
+        return n;
+    }
+
+    bool empty() const {
+        for (auto w: words_) if (w) return false;
+        return true;
+    }
+
+    // Packed representation: bit i%64 of words()[i/64] is set if index i is set.
+    const std::vector<std::uint64_t>& words() const { return words_; }
+
+    // Iterates over set indices in increasing order.
+    struct iterator {
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::size_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::size_t*;
+        using reference = std::size_t;
+
+        iterator() = default;
+        iterator(const std::vector<std::uint64_t>* w, std::size_t k): w_(w), k_(k) { advance(); }
+
+        std::size_t operator*() const { return 64*k_+impl::ctz64(bits_); }
+
+        iterator& operator++() {
+            bits_ &= bits_-1;
+            if (!bits_) ++k_, advance();
+            return *this;
+        }
+
+        iterator operator++(int) { auto x = *this; return ++*this, x; }
+
+        bool operator==(const iterator& x) const { return k_==x.k_ && bits_==x.bits_; }
+        bool operator!=(const iterator& x) const { return !(*this==x); }
+
+    private:
+        const std::vector<std::uint64_t>* w_ = nullptr;
+        std::size_t k_ = 0;
+        std::uint64_t bits_ = 0;
+
+        void advance() {
+            for (; k_<w_->size(); ++k_) {
+                if ((bits_ = (*w_)[k_])) return;
+            }
+        }
+    };
+
+    iterator begin() const { return iterator(&words_, 0); }
+    iterator end() const { return iterator(&words_, words_.size()); }
+};
+
+class cpulist_parser {
+    delimited_parser<interval_parser<std::size_t>> parse_;
+    std::size_t limit_;
+
+public:
+    explicit cpulist_parser(std::size_t limit = 65536):
+        parse_(',', interval_parser<std::size_t>{}), limit_(limit) {}
+
+    maybe<cpu_set> operator()(const char* text) const {
+        cpu_set cpus;
+        bool in_range = true;
+        auto set_interval = [this, &cpus, &in_range](const interval<std::size_t>& iv) {
+            if (iv.last>=limit_) in_range = false;
+            if (!in_range) return;
+
+            for (std::size_t i = iv.first;; i += iv.stride) {
+                cpus.set(i);
+                if (iv.last-i<iv.stride) break;
+            }
+        };
+
+        if (parse_.for_each(text, set_interval) && in_range) return cpus;
+        else return nothing;
+    }
+};
+
+inline cpulist_parser cpulist(std::size_t limit = 65536) {
+    return cpulist_parser(limit);
+}
+
+// Binary data
+//
+// hex_parser and base64_parser decode an argument into a vector of
+// bytes. Hex arguments may have a leading "0x" or "0X", and must have an
+// even number of digits in either case. Base64 arguments use the standard
+// alphabet (or the URL-safe alphabet, if so constructed), and may omit the
+// trailing padding.
+//
+// Digits are looked up in a 256-entry table, with any invalid character
+// flagged in a high bit that is accumulated over the whole argument and
+// checked once at the end; the inner loops are free of branches, and
+// amenable to vectorization by the compiler.
+//
+// Both parsers accept a character range, and provide copy(text, out),
+// which writes the decoded bytes through the output iterator out and
+// returns a maybe holding its final value. This allows decoding directly
+// into caller-provided storage; if decoding fails, the bytes written to
+// out are unspecified.
+
+namespace impl {
+    // Maps each character to its digit value, or to 0x80 if it is not a digit.
+    struct digit_table {
+        unsigned char value[256];
+    };
+
+    constexpr digit_table make_digit_table(const char* digits, bool fold_case = false) {
+        digit_table t{};
+        for (auto& v: t.value) v = 0x80;
+        for (unsigned char i = 0; digits[i]; ++i) {
+            unsigned char c = digits[i];
+            t.value[c] = i;
+            if (fold_case && c>='a' && c<='z') t.value[c-'a'+'A'] = i;
+        }
+        return t;
+    }
+
+    inline const digit_table& hex_digits() {
+        static constexpr digit_table t = make_digit_table("0123456789abcdef", true);
+        return t;
+    }
+
+    inline const digit_table& base64_digits(bool url_safe) {
+        static constexpr digit_table t = make_digit_table("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/");
+        static constexpr digit_table u = make_digit_table("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_");
+        return url_safe? u: t;
+    }
+}
+
+struct hex_parser {
+    template <typename OutIter>
+    maybe<OutIter> decode(const char* b, const char* e, OutIter out) const {
+        if (e-b>=2 && b[0]=='0' && (b[1]=='x' || b[1]=='X')) b += 2;
+        if ((e-b)%2) return nothing;
+
+        const unsigned char* digit = impl::hex_digits().value;
+        unsigned char bad = 0;
+        for (; b!=e; b += 2) {
+            unsigned char hi = digit[(unsigned char)b[0]], lo = digit[(unsigned char)b[1]];
+            bad |= hi|lo;
+            *out++ = static_cast<unsigned char>(hi<<4|lo);
+        }
+
+        if (bad&0x80) return nothing;
+        return out;
+    }
+
+    template <typename OutIter>
+    maybe<OutIter> copy(const char* text, OutIter out) const {
+        if (!text) return nothing;
+        return decode(text, text+std::strlen(text), out);
+    }
+
+    maybe<std::vector<unsigned char>> operator()(const char* b, const char* e) const {
+        std::vector<unsigned char> bytes((e-b)/2);
+        if (auto end = decode(b, e, bytes.data())) {
+            bytes.resize(*end-bytes.data());
+            return bytes;
+        }
+        return nothing;
+    }
+
+    maybe<std::vector<unsigned char>> operator()(const char* text) const {
+        if (!text) return nothing;
+        return (*this)(text, text+std::strlen(text));
+    }
+};
+
+class base64_parser {
+    bool url_safe_;
+
+public:
+    explicit base64_parser(bool url_safe = false): url_safe_(url_safe) {}
+
+    template <typename OutIter>
+    maybe<OutIter> decode(const char* b, const char* e, OutIter out) const {
+        if ((e-b)%4==0) {
+            for (int i = 0; i<2 && e!=b && e[-1]=='='; ++i) --e;
+        }
+        if ((e-b)%4==1) return nothing;
+
+        const unsigned char* digit = impl::base64_digits(url_safe_).value;
+        unsigned char bad = 0;
+        for (; e-b>=4; b += 4) {
+            unsigned char d0 = digit[(unsigned char)b[0]], d1 = digit[(unsigned char)b[1]];
+            unsigned char d2 = digit[(unsigned char)b[2]], d3 = digit[(unsigned char)b[3]];
+            bad |= d0|d1|d2|d3;
+
+            std::uint32_t w = std::uint32_t(d0)<<18 | std::uint32_t(d1)<<12 | std::uint32_t(d2)<<6 | d3;
+            *out++ = static_cast<unsigned char>(w>>16);
+            *out++ = static_cast<unsigned char>(w>>8);
+            *out++ = static_cast<unsigned char>(w);
+        }
+
+        // Final two or three digits encode one or two bytes.
+        if (b!=e) {
+            unsigned char d0 = digit[(unsigned char)b[0]], d1 = digit[(unsigned char)b[1]];
+            unsigned char d2 = e-b==3? digit[(unsigned char)b[2]]: 0;
+            bad |= d0|d1|d2;
+
+            *out++ = static_cast<unsigned char>(d0<<2|d1>>4);
+            if (e-b==3) *out++ = static_cast<unsigned char>(d1<<4|d2>>2);
+        }
+
+        if (bad&0x80) return nothing;
+        return out;
+    }
+
+    template <typename OutIter>
+    maybe<OutIter> copy(const char* text, OutIter out) const {
+        if (!text) return nothing;
+        return decode(text, text+std::strlen(text), out);
+    }
+
+    maybe<std::vector<unsigned char>> operator()(const char* b, const char* e) const {
+        std::vector<unsigned char> bytes((e-b+3)/4*3);
+        if (auto end = decode(b, e, bytes.data())) {
+            bytes.resize(*end-bytes.data());
+            return bytes;
+        }
+        return nothing;
+    }
+
+    maybe<std::vector<unsigned char>> operator()(const char* text) const {
+        if (!text) return nothing;
+        return (*this)(text, text+std::strlen(text));
+    }
+};
+
+// Sizes and durations
+//
+// size_parser reads a byte count: a number, optionally with a decimal
+// fraction, followed by an optional multiplier prefix and 'B'. The
+// prefixes k (or K), M, G, T, P and E denote powers of 1000; followed by
+// 'i', as in KiB, they denote powers of 1024. For example, "4GiB" is
+// 4294967296 and "1.5k" is 1500.
+//
+// duration_parser<D> reads a std::chrono duration D as one or more terms,
+// each a number with an optional decimal fraction and a unit: ns, us (or
+// µs), ms, s, m (or min), h or d, as in "250ms" or "1h30m". A single
+// number without a unit is taken to be a count of D ticks. Durations
+// with a floating point representation are computed in floating point.
+//
+// Numbers are scanned once without any intermediate string. Values that
+// overflow their type, or that are not a whole number of bytes or (for
+// integral D) of D ticks, are rejected rather than rounded.
+
+namespace impl {
+    inline bool mul_checked(std::uint64_t a, std::uint64_t b, std::uint64_t& r) {
+#if defined(__GNUC__)
+        return !__builtin_mul_overflow(a, b, &r);
+#else
+        if (b && a>std::numeric_limits<std::uint64_t>::max()/b) return false;
+        r = a*b;
+        return true;
+#endif
+    }
+
+    inline bool pow10_checked(unsigned n, std::uint64_t& r) {
+        for (r = 1; n; --n) {
+            if (!mul_checked(r, 10, r)) return false;
+        }
+        return true;
+    }
+
+    // Scan a non-negative decimal number with an optional fractional part
+    // as its digits m and number of fractional digits d, so that its value
+    // is m/10^d. Trailing zeros in the fraction are dropped. Returns the
+    // end of the number, or nullptr on syntax error or overflow.
+    inline const char* scan_decimal(const char* p, const char* e, std::uint64_t& m, unsigned& d) {
+        m = 0;
+        d = 0;
+
+        bool any = false, frac = false;
+        unsigned zeros = 0;
+        for (; p!=e; ++p) {
+            if (*p=='.' && !frac) {
+                frac = true;
+                continue;
+            }
+            if (!is_digit(*p)) break;
+
+            unsigned c = *p-'0';
+            any = true;
+            if (frac) {
+                if (!c) {
+                    ++zeros;
+                    continue;
+                }
+                d += zeros+1;
+                for (; zeros; --zeros) {
+                    if (!mul_checked(m, 10, m)) return nullptr;
+                }
+            }
+            if (!mul_checked(m, 10, m) || m+c<m) return nullptr;
+            m += c;
+        }
+        return any? p: nullptr;
+    }
+}
+
+struct size_parser {
+    maybe<std::uint64_t> operator()(const char* b, const char* e) const {
+        std::uint64_t m;
+        unsigned d;
+        const char* p = impl::scan_decimal(impl::skip_space(b, e), e, m, d);
+        if (!p) return nothing;
+        p = impl::skip_space(p, e);
+
+        static constexpr char prefixes[] = "kMGTPE";
+        std::uint64_t multiplier = 1;
+        if (p!=e && *p) {
+            if (const char* q = std::strchr(prefixes, *p=='K'? 'k': *p)) {
+                unsigned base = 1000;
+                if (++p!=e && *p=='i') base = 1024, ++p;
+                for (auto n = q-prefixes+1; n; --n) multiplier *= base;
+            }
+            if (p!=e && *p=='B') ++p;
+        }
+        if (impl::skip_space(p, e)!=e) return nothing;
+
+        std::uint64_t n, scale;
+        if (!impl::mul_checked(m, multiplier, n) || !impl::pow10_checked(d, scale) || n%scale) return nothing;
+        return n/scale;
+    }
+
+    maybe<std::uint64_t> operator()(const char* text) const {
+        if (!text) return nothing;
+        return (*this)(text, text+std::strlen(text));
+    }
+};
+
+template <typename D = std::chrono::nanoseconds>
+class duration_parser {
+    using rep = typename D::rep;
+    using accumulator = std::conditional_t<std::is_floating_point<rep>::value, long double, std::uint64_t>;
+
+    // A unit is num/den ticks of D.
+    struct unit {
+        const char* name;
+        std::intmax_t num, den;
+    };
+
+    template <typename R>
+    static constexpr unit make_unit(const char* name) {
+        using ticks = std::ratio_divide<R, typename D::period>;
+        return unit{name, ticks::num, ticks::den};
+    }
+
+    static const unit* find_unit(const char* b, const char* e) {
+        static constexpr unit units[] = {
+            make_unit<std::nano>("ns"),
+            make_unit<std::micro>("us"),
+            make_unit<std::micro>("\xc2\xb5s"),
+            make_unit<std::milli>("ms"),
+            make_unit<std::ratio<1>>("s"),
+            make_unit<std::ratio<60>>("m"),
+            make_unit<std::ratio<60>>("min"),
+            make_unit<std::ratio<3600>>("h"),
+            make_unit<std::ratio<86400>>("d")
+        };
+
+        std::size_t n = e-b;
+        for (const auto& u: units) {
+            if (std::strlen(u.name)==n && !std::memcmp(u.name, b, n)) return &u;
+        }
+        return nullptr;
+    }
+
+    static bool add_term(std::uint64_t& acc, std::uint64_t m, unsigned d, const unit& u) {
+        std::uint64_t n, q, scale;
+        if (!impl::mul_checked(m, u.num, n) || !impl::pow10_checked(d, scale) ||
+            !impl::mul_checked(u.den, scale, q) || n%q) return false;
+
+        acc += n/q;
+        return acc>=n/q && acc<=static_cast<std::uint64_t>(std::numeric_limits<rep>::max());
+    }
+
+    static bool add_term(long double& acc, std::uint64_t m, unsigned d, const unit& u) {
+        long double x = static_cast<long double>(m)*u.num/u.den;
+        for (; d; --d) x /= 10;
+        acc += x;
+        return true;
+    }
+
+public:
+    maybe<D> operator()(const char* b, const char* e) const {
+        static constexpr unit tick{"", 1, 1};
+
+        const char* p = impl::skip_space(b, e);
+        if (p==e) return nothing;
+
+        accumulator acc = 0;
+        for (bool first = true; p!=e; first = false) {
+            std::uint64_t m;
+            unsigned d;
+            if (!(p = impl::scan_decimal(p, e, m, d))) return nothing;
+            p = impl::skip_space(p, e);
+
+            const char* q = p;
+            while (q!=e && !impl::is_digit(*q) && !impl::is_space(*q) && *q!='.') ++q;
+
+            const unit* u = q==p? (first && q==e? &tick: nullptr): find_unit(p, q);
+            if (!u || !add_term(acc, m, d, *u)) return nothing;
+            p = impl::skip_space(q, e);
+        }
+        return D(static_cast<rep>(acc));
+    }
+
+    maybe<D> operator()(const char* text) const {
+        if (!text) return nothing;
+        return (*this)(text, text+std::strlen(text));
+    }
+};
+
+// Option keys
+// -----------
+//
+// A key is how the option is specified in an argument list, and is typically
+// represented as a 'short' (e.g. '-a') option or a 'long' option (e.g.
+// '--apple').
+//
+// The value for an option can always be taken from the next argument in the
+// list, but in addition can be specified together with the key itself,
 // depending on the properties of the option key:
 //
 //     --key=value         'Long' style argument for key "--key"
@@ -400,36 +2279,237 @@ auto delimited(char delim = ',') {
 // with keys are always checked first.
 //
 // Only short and long kets can be used with to::parse.
+//
+// The label of a key is a key_label, which either holds a copy of the label
+// text or, when constructed with the key_label::static_t tag, refers to
+// NUL-terminated storage that outlives it, such as a string literal. Keys
+// made with the string literal operators _short, _long and _compact refer
+// to the literal. Copied labels short enough for the small string
+// optimization, as most are, also avoid allocation. The label length and
+// hash are computed once on construction.
+
+class key_label {
+    std::string own_;
+    const char* data_;
+    std::size_t size_;
+    std::size_t hash_;
+    bool owned_;
+
+    void reset() noexcept {
+        own_.clear();
+        data_ = "";
+        size_ = 0;
+        hash_ = impl::hash_bytes(data_, 0);
+        owned_ = false;
+    }
+
+public:
+    // Tag for constructor.
+    struct static_t {};
+
+    explicit key_label(std::string label):
+        own_(std::move(label)), data_(own_.c_str()), size_(own_.size()),
+        hash_(impl::hash_bytes(data_, size_)), owned_(true)
+    {}
+
+    key_label(static_t, const char* label, std::size_t n):
+        data_(label), size_(n), hash_(impl::hash_bytes(label, n)), owned_(false)
+    {}
+
+    key_label(const key_label& other):
+        own_(other.own_), data_(other.owned_? own_.c_str(): other.data_),
+        size_(other.size_), hash_(other.hash_), owned_(other.owned_)
+    {}
+
+    // A moved-from label is left empty.
+    key_label(key_label&& other) noexcept:
+        own_(std::move(other.own_)), data_(other.owned_? own_.c_str(): other.data_),
+        size_(other.size_), hash_(other.hash_), owned_(other.owned_)
+    {
+        other.reset();
+    }
+
+    key_label& operator=(const key_label& other) {
+        return *this = key_label(other);
+    }
+
+    key_label& operator=(key_label&& other) noexcept {
+        if (this==&other) return *this;
+        own_ = std::move(other.own_);
+        data_ = other.owned_? own_.c_str(): other.data_;
+        size_ = other.size_;
+        hash_ = other.hash_;
+        owned_ = other.owned_;
+        other.reset();
+        return *this;
+    }
+
+    const char* data() const { return data_; }
+    const char* c_str() const { return data_; }
+    std::size_t size() const { return size_; }
+    std::size_t length() const { return size_; }
+    bool empty() const { return !size_; }
+    std::size_t hash() const { return hash_; }
+
+    const char* begin() const { return data_; }
+    const char* end() const { return data_+size_; }
+    char operator[](std::size_t i) const { return data_[i]; }
+
+    std::string str() const { return std::string(data_, size_); }
+    operator std::string() const { return str(); }
+
+#if __cplusplus>=201703
+    operator std::string_view() const { return std::string_view(data_, size_); }
+#endif
+
+    friend bool operator==(const key_label& a, const key_label& b) {
+        return a.size_==b.size_ && !std::memcmp(a.data_, b.data_, a.size_);
+    }
+
+    friend bool operator==(const key_label& a, const char* b) {
+        return !std::strncmp(a.data_, b, a.size_) && !b[a.size_];
+    }
+
+    friend bool operator==(const key_label& a, const std::string& b) {
+        return a.size_==b.size() && !std::memcmp(a.data_, b.data(), a.size_);
+    }
+
+    friend bool operator==(const char* a, const key_label& b) { return b==a; }
+    friend bool operator==(const std::string& a, const key_label& b) { return b==a; }
+
+    template <typename X>
+    friend bool operator!=(const key_label& a, const X& b) { return !(a==b); }
+
+    template <typename X, typename = std::enable_if_t<!std::is_same<X, key_label>::value>>
+    friend bool operator!=(const X& a, const key_label& b) { return !(b==a); }
+
+    friend std::ostream& operator<<(std::ostream& out, const key_label& label) {
+        return out.write(label.data_, label.size_);
+    }
+};
+
+struct key {
+    key_label label;
+    enum style { shortfmt, longfmt, compact } style = shortfmt;
+
+    key(key_label l): label(std::move(l)) {
+        if (label[0]=='-' && label[1]=='-') style = longfmt;
+    }
+
+    key(std::string label): key(key_label(std::move(label))) {}
+
+    key(const char* label): key(std::string(label)) {}
+
+#if __cplusplus>=201703
+    key(std::string_view label): key(std::string(label)) {}
+#endif
+
+    key(key_label label, enum style style):
+        label(std::move(label)), style(style) {}
+
+    key(std::string label, enum style style):
+        key(key_label(std::move(label)), style) {}
+};
+
+inline namespace literals {
+
+inline key operator""_short(const char* label, std::size_t n) {
+    return key(key_label(key_label::static_t{}, label, n), key::shortfmt);
+}
+
+inline key operator""_long(const char* label, std::size_t n) {
+    return key(key_label(key_label::static_t{}, label, n), key::longfmt);
+}
+
+inline key operator""_compact(const char* label, std::size_t n) {
+    return key(key_label(key_label::static_t{}, label, n), key::compact);
+}
+
+} // namespace literals
+
+// Argument spans
+// --------------
+//
+// An arg_span is a selection of the arguments in an argument list, such as
+// those left unmatched by to::run(), represented by ascending ranges of
+// indices into the list. The list itself is not copied or modified, and
+// must outlive the span. A long run of consecutive arguments is held as a
+// single range.
+
+class arg_span {
+    const char* const* argv_ = nullptr;
+    std::vector<std::pair<std::size_t, std::size_t>> ranges_;
+    std::size_t size_ = 0;
+
+public:
+    arg_span() = default;
+    explicit arg_span(const char* const* argv): argv_(argv) {}
+
+    const char* const* argv() const { return argv_; }
+
+    // Index ranges [first, second) into argv().
+    const std::vector<std::pair<std::size_t, std::size_t>>& ranges() const { return ranges_; }
+
+    std::size_t size() const { return size_; }
+    bool empty() const { return !size_; }
 
-struct key {
-    std::string label;
-    enum style { shortfmt, longfmt, compact } style = shortfmt;
+    // Append the arguments with indices in [b, e); b must be no less than
+    // the end of the last range.
+    void append(std::size_t b, std::size_t e) {
+        if (b==e) return;
+        if (!ranges_.empty() && ranges_.back().second==b) ranges_.back().second = e;
+        else ranges_.emplace_back(b, e);
+        size_ += e-b;
+    }
 
-    key(std::string l): label(std::move(l)) {
-        if (label[0]=='-' && label[1]=='-') style = longfmt;
+    void push_back(std::size_t index) {
+        append(index, index+1);
     }
 
-    key(const char* label): key(std::string(label)) {}
+    class iterator {
+        const arg_span* span_ = nullptr;
+        std::size_t range_ = 0;
+        std::size_t index_ = 0;
 
-    key(std::string label, enum style style):
-        label(std::move(label)), style(style) {}
-};
+        friend class arg_span;
+        iterator(const arg_span* span, std::size_t range):
+            span_(span), range_(range),
+            index_(range<span->ranges_.size()? span->ranges_[range].first: 0)
+        {}
 
-inline namespace literals {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = const char*;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const char* const*;
+        using reference = const char* const&;
 
-inline key operator""_short(const char* label, std::size_t) {
-    return key(label, key::shortfmt);
-}
+        iterator() = default;
 
-inline key operator""_long(const char* label, std::size_t) {
-    return key(label, key::longfmt);
-}
+        // Index of the current argument in the argument list.
+        std::size_t index() const { return index_; }
 
-inline key operator""_compact(const char* label, std::size_t) {
-    return key(label, key::compact);
-}
+        reference operator*() const { return span_->argv_[index_]; }
+        pointer operator->() const { return span_->argv_+index_; }
 
-} // namespace literals
+        iterator& operator++() {
+            if (++index_==span_->ranges_[range_].second) *this = iterator(span_, range_+1);
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator i = *this;
+            ++*this;
+            return i;
+        }
+
+        bool operator==(const iterator& other) const { return range_==other.range_ && index_==other.index_; }
+        bool operator!=(const iterator& other) const { return !(*this==other); }
+    };
+
+    iterator begin() const { return iterator(this, 0); }
+    iterator end() const { return iterator(this, ranges_.size()); }
+};
 
 // Argument state
 // --------------
@@ -446,11 +2526,36 @@ struct state {
     char** argv;
     unsigned optoff = 0;
 
+    // If not null, compaction of the argument list is deferred (see defer()).
+    char** kept = nullptr;
+
+    // If not null, the argument list is left unmodified (see record()).
+    arg_span* unmatched = nullptr;
+
+    // True if any argument has been skipped.
+    bool skipped = false;
+
     state(int& argc, char** argv): argc(argc), argv(argv) {}
 
     // False => no more arguments.
     explicit operator bool() const { return *argv; }
 
+    // Defer compaction of the argument list: rather than moving the
+    // remainder of the list on each shift(), skipped arguments are copied
+    // down to follow those skipped before them, over any consumed arguments,
+    // and compact() closes the remaining gap. argc is maintained as before,
+    // but the list itself is only consistent after compact().
+    void defer() {
+        kept = argv;
+    }
+
+    // Leave the argument list unmodified: shift() advances past consumed
+    // arguments, and skip() appends the index of each skipped argument to
+    // span, which must refer to the same argument list.
+    void record(arg_span& span) {
+        unmatched = &span;
+    }
+
     // Shift arguments left in-place.
     void shift(unsigned n = 1) {
         if (!n) return;
@@ -459,15 +2564,42 @@ struct state {
         while (*skip && n) ++skip, --n;
 
         argc -= (skip-argv);
-        auto p = argv;
-        do { *p++ = *skip; } while (*skip++);
+        if (kept || unmatched) {
+            argv = skip;
+        }
+        else {
+            auto p = argv;
+            do { *p++ = *skip; } while (*skip++);
+        }
 
         optoff = 0;
     }
 
     // Skip current argument without modifying list.
     void skip() {
-         if (*argv) ++argv;
+        if (*argv) {
+            if (unmatched) {
+                const char* const* arg = argv;
+                unmatched->push_back(arg-unmatched->argv());
+            }
+            else if (kept) {
+                *kept++ = *argv;
+            }
+            ++argv;
+            skipped = true;
+        }
+        optoff = 0;
+    }
+
+    // With deferred compaction, move the unprocessed arguments down to
+    // follow the skipped arguments.
+    void compact() {
+        if (!kept || kept==argv) return;
+
+        auto p = kept;
+        auto q = argv;
+        do { *p++ = *q; } while (*q++);
+        argv = kept;
     }
 
     struct match_result {
@@ -486,12 +2618,7 @@ struct state {
     // argument string, else return nothing.
     maybe<match_result> match_option(const key& k) {
         if (k.style==key::compact) {
-            if (auto m = match_compact_key(k.label.c_str())) {
-                if ((*argv)[optoff+*m])
-                    return match_result{*argv+optoff+*m, 1, 0};
-                else
-                    return match_result{argv[1], 2, 0};
-            }
+            if (auto m = match_compact_key(k.label.c_str())) return compact_option(*m);
         }
         else if (!optoff && k.label==*argv) {
             return match_result{argv[1], 2, 0};
@@ -510,12 +2637,7 @@ struct state {
     // If successful, consume match_result with nullptr for option argvument.
     maybe<match_result> match_flag(const key& k) {
         if (k.style==key::compact) {
-            if (auto m = match_compact_key(k.label.c_str())) {
-                if ((*argv)[optoff+*m]) 
-                    return match_result{nullptr, 0, *m};
-                else
-                    return match_result{nullptr, 1, 0};
-            }
+            if (auto m = match_compact_key(k.label.c_str())) return compact_flag(*m);
         }
         else if (!optoff && k.label==*argv) {
             return match_result{nullptr, 1, 0};
@@ -524,6 +2646,22 @@ struct state {
         return nothing;
     }
 
+    // Match results for a compact key of an option or flag respectively,
+    // given the number of characters n it occupies at the current position.
+    match_result compact_option(unsigned n) const {
+        if ((*argv)[optoff+n])
+            return match_result{*argv+optoff+n, 1, 0};
+        else
+            return match_result{argv[1], 2, 0};
+    }
+
+    match_result compact_flag(unsigned n) const {
+        if ((*argv)[optoff+n])
+            return match_result{nullptr, 0, n};
+        else
+            return match_result{nullptr, 1, 0};
+    }
+
     // Compact-style keys can be combined in one argument; combined keys
     // with a common prefix only need to supply the prefix once at the
     // beginning of the argument.
@@ -598,10 +2736,7 @@ struct sink {
 
     template <typename V, typename P>
     sink(V& var, P parser):
-        sink(action, [ref=std::ref(var), parser](const char* param) {
-                if (auto p = parser(param)) return ref.get() = std::move(*p), true;
-                else return false;
-            })
+        sink(action, impl::parse_into_action(var, std::move(parser)))
     {}
 
     template <typename Action>
@@ -647,18 +2782,64 @@ inline sink error(std::string message) {
 // occurance of a flag, set a fixed value when a flag is provided, or for
 // appending an option parameter onto a vector of values.
 
+namespace impl {
+    // Append a parsed value, constructing it in place if the parser supports parse_into.
+    template <typename Container, typename P, typename V = typename Container::value_type,
+        std::enable_if_t<has_parse_into<P, V>::value && std::is_default_constructible<V>::value, int> = 0>
+    bool push_back_parsed(Container& c, const P& parser, const char* arg) {
+        c.emplace_back();
+        if (parser.parse_into(arg, c.back())) return true;
+
+        c.pop_back();
+        return false;
+    }
+
+    template <typename Container, typename P, typename V = typename Container::value_type,
+        std::enable_if_t<!(has_parse_into<P, V>::value && std::is_default_constructible<V>::value), int> = 0>
+    bool push_back_parsed(Container& c, const P& parser, const char* arg) {
+        if (auto v = parser(arg)) return c.push_back(std::move(*v)), true;
+        else return false;
+    }
+}
+
 // Push parsed option parameter on to container.
 template <typename Container, typename P = default_parser<typename Container::value_type>>
 sink push_back(Container& c, P parser = P{}) {
-    return action(
-        [ref = std::ref(c)](typename Container::value_type v) { ref.get().push_back(std::move(v)); },
-        std::move(parser));
+    return sink(sink::action,
+        [ref = std::ref(c), parser = std::move(parser)](const char* arg) {
+            return impl::push_back_parsed(ref.get(), parser, arg);
+        });
+}
+
+// Pass each element of a delimited option parameter to f as it is parsed.
+template <typename F, typename P>
+sink for_each(F f, delimited_parser<P> parser, bool validate = false) {
+    return sink(sink::action,
+        [f = std::move(f), parser = std::move(parser), validate](const char* arg) mutable {
+            return parser.for_each(arg, f, validate);
+        });
+}
+
+// Write each element of a delimited option parameter through the output
+// iterator out as it is parsed.
+template <typename OutIter, typename P>
+sink copy_to(OutIter out, delimited_parser<P> parser, bool validate = false) {
+    return sink(sink::action,
+        [out = std::move(out), parser = std::move(parser), validate](const char* arg) mutable {
+            if (auto r = parser.copy(arg, out, validate)) return out = *r, true;
+            else return false;
+        });
 }
 
+// The adaptors below construct their sinks directly rather than through
+// action(), keeping the wrapped function objects small and trivially
+// copyable so that std::function can usually store them without allocating.
+
 // Set v to value when option parsed; ignore any option parameter.
 template <typename V, typename X>
 sink set(V& v, X value) {
-    return action([ref = std::ref(v), value = std::move(value)] { ref.get() = value; });
+    return sink(sink::action,
+        [ref = std::ref(v), value = std::move(value)](const char*) { ref.get() = value; return true; });
 }
 
 // Set v to true when option parsed; ignore any option parameter.
@@ -670,12 +2851,14 @@ sink set(V& v) {
 // Incrememnt v when option parsed; ignore any option parameter.
 template <typename V>
 sink increment(V& v) {
-    return action([ref = std::ref(v)] { ++ref.get(); });
+    return sink(sink::action,
+        [ref = std::ref(v)](const char*) { ++ref.get(); return true; });
 }
 
 template <typename V, typename X>
 sink increment(V& v, X delta) {
-    return action([ref = std::ref(v), delta = std::move(delta)] { ref.get() += delta; });
+    return sink(sink::action,
+        [ref = std::ref(v), delta = std::move(delta)](const char*) { ref.get() += delta; return true; });
 }
 
 // Modal configuration
@@ -700,8 +2883,10 @@ sink increment(V& v, X delta) {
 // The argument to the functional is the current mode; the return value
 // sets the new value of mode.
 //
-// Filters are called before keys are matched; modal changes are called
-// after an option is processed. All 
+// Filters are called before keys are matched, though to::run() only
+// consults the filters of options that have a key which could match the
+// current argument, or which have no keys; modal changes are called after
+// an option is processed.
 
 using filter = std::function<bool (int)>;
 using modal = std::function<int (int)>;
@@ -753,11 +2938,247 @@ enum option_flag {
     lax = 64,       // Option does not throw an error if argument fails to parse or is missing.
 };
 
+namespace impl {
+    // A vector with inline storage for up to N elements, used for the
+    // keys, filters and modals of an option, which are usually few. It
+    // provides the commonly used parts of the std::vector interface, and
+    // converts to and from std::vector<T>.
+    template <typename T, std::size_t N>
+    class small_vector {
+        static_assert(N>0, "small_vector requires inline capacity");
+
+        T* data_;
+        std::size_t size_ = 0;
+        std::size_t capacity_ = N;
+        alignas(T) unsigned char inline_[N*sizeof(T)];
+
+        T* inline_data() { return reinterpret_cast<T*>(inline_); }
+        bool is_inline() const { return data_==reinterpret_cast<const T*>(inline_); }
+
+        void release() {
+            if (!is_inline()) std::allocator<T>{}.deallocate(data_, capacity_);
+            data_ = inline_data();
+            capacity_ = N;
+        }
+
+        // Take the elements of other, given *this is empty with inline storage.
+        void take(small_vector&& other) {
+            if (other.is_inline()) {
+                for (auto& x: other) emplace_back(std::move(x));
+                other.clear();
+            }
+            else {
+                data_ = other.data_;
+                size_ = other.size_;
+                capacity_ = other.capacity_;
+                other.data_ = other.inline_data();
+                other.size_ = 0;
+                other.capacity_ = N;
+            }
+        }
+
+    public:
+        using value_type = T;
+        using size_type = std::size_t;
+        using difference_type = std::ptrdiff_t;
+        using reference = T&;
+        using const_reference = const T&;
+        using iterator = T*;
+        using const_iterator = const T*;
+
+        small_vector(): data_(inline_data()) {}
+
+        template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+        small_vector(InputIt b, InputIt e): small_vector() { assign(b, e); }
+
+        small_vector(std::initializer_list<T> il): small_vector(il.begin(), il.end()) {}
+        small_vector(const std::vector<T>& v): small_vector(v.begin(), v.end()) {}
+
+        small_vector(const small_vector& other): small_vector() {
+            reserve(other.size_);
+            for (auto& x: other) emplace_back(x);
+        }
+
+        small_vector(small_vector&& other) noexcept(std::is_nothrow_move_constructible<T>::value):
+            small_vector()
+        {
+            take(std::move(other));
+        }
+
+        small_vector& operator=(const small_vector& other) {
+            if (this!=&other) {
+                clear();
+                reserve(other.size_);
+                for (auto& x: other) emplace_back(x);
+            }
+            return *this;
+        }
+
+        small_vector& operator=(small_vector&& other) noexcept(std::is_nothrow_move_constructible<T>::value) {
+            if (this!=&other) {
+                clear();
+                release();
+                take(std::move(other));
+            }
+            return *this;
+        }
+
+        small_vector& operator=(std::initializer_list<T> il) {
+            assign(il.begin(), il.end());
+            return *this;
+        }
+
+        small_vector& operator=(const std::vector<T>& v) {
+            assign(v.begin(), v.end());
+            return *this;
+        }
+
+        ~small_vector() {
+            clear();
+            release();
+        }
+
+        operator std::vector<T>() const { return std::vector<T>(begin(), end()); }
+
+        std::size_t size() const { return size_; }
+        std::size_t capacity() const { return capacity_; }
+        bool empty() const { return !size_; }
+
+        T* data() { return data_; }
+        const T* data() const { return data_; }
+
+        T* begin() { return data_; }
+        T* end() { return data_+size_; }
+        const T* begin() const { return data_; }
+        const T* end() const { return data_+size_; }
+        const T* cbegin() const { return data_; }
+        const T* cend() const { return data_+size_; }
+
+        T& operator[](std::size_t i) { return data_[i]; }
+        const T& operator[](std::size_t i) const { return data_[i]; }
+
+        T& at(std::size_t i) {
+            if (i>=size_) throw std::out_of_range("small_vector::at");
+            return data_[i];
+        }
+
+        const T& at(std::size_t i) const {
+            if (i>=size_) throw std::out_of_range("small_vector::at");
+            return data_[i];
+        }
+
+        T& front() { return data_[0]; }
+        const T& front() const { return data_[0]; }
+        T& back() { return data_[size_-1]; }
+        const T& back() const { return data_[size_-1]; }
+
+        void reserve(std::size_t n) {
+            if (n<=capacity_) return;
+
+            T* p = std::allocator<T>{}.allocate(n);
+            std::size_t i = 0;
+            try {
+                for (; i<size_; ++i) ::new (static_cast<void*>(p+i)) T(std::move_if_noexcept(data_[i]));
+            }
+            catch (...) {
+                while (i) p[--i].~T();
+                std::allocator<T>{}.deallocate(p, n);
+                throw;
+            }
+
+            std::size_t n_elem = size_;
+            clear();
+            release();
+            data_ = p;
+            size_ = n_elem;
+            capacity_ = n;
+        }
+
+        template <typename... A>
+        T& emplace_back(A&&... a) {
+            if (size_==capacity_) {
+                // Construct first in case a refers to an element.
+                T x(std::forward<A>(a)...);
+                reserve(2*capacity_);
+                ::new (static_cast<void*>(data_+size_)) T(std::move(x));
+            }
+            else {
+                ::new (static_cast<void*>(data_+size_)) T(std::forward<A>(a)...);
+            }
+            return data_[size_++];
+        }
+
+        void push_back(const T& x) { emplace_back(x); }
+        void push_back(T&& x) { emplace_back(std::move(x)); }
+
+        void pop_back() { data_[--size_].~T(); }
+
+        void clear() {
+            while (size_) pop_back();
+        }
+
+        template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+        void assign(InputIt b, InputIt e) {
+            clear();
+            for (; b!=e; ++b) emplace_back(*b);
+        }
+
+        void assign(std::initializer_list<T> il) { assign(il.begin(), il.end()); }
+
+        void assign(std::size_t n, const T& x) {
+            T copy(x);
+            clear();
+            reserve(n);
+            while (size_<n) emplace_back(copy);
+        }
+
+        // Elements are appended and then rotated into place; as for
+        // std::vector, the range [b, e) must not refer to *this.
+        template <typename... A>
+        T* emplace(const T* pos, A&&... a) {
+            std::size_t i = pos-data_;
+            emplace_back(std::forward<A>(a)...);
+            std::rotate(data_+i, data_+size_-1, data_+size_);
+            return data_+i;
+        }
+
+        T* insert(const T* pos, const T& x) { return emplace(pos, x); }
+        T* insert(const T* pos, T&& x) { return emplace(pos, std::move(x)); }
+
+        template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+        T* insert(const T* pos, InputIt b, InputIt e) {
+            std::size_t i = pos-data_, n = size_;
+            for (; b!=e; ++b) emplace_back(*b);
+            std::rotate(data_+i, data_+n, data_+size_);
+            return data_+i;
+        }
+
+        T* insert(const T* pos, std::initializer_list<T> il) { return insert(pos, il.begin(), il.end()); }
+
+        T* erase(const T* b, const T* e) {
+            T* p = data_+(b-data_);
+            if (b!=e) {
+                std::move(data_+(e-data_), end(), p);
+                for (auto n = e-b; n>0; --n) pop_back();
+            }
+            return p;
+        }
+
+        T* erase(const T* pos) { return erase(pos, pos+1); }
+
+        friend bool operator==(const small_vector& a, const small_vector& b) {
+            return a.size()==b.size() && std::equal(a.begin(), a.end(), b.begin());
+        }
+
+        friend bool operator!=(const small_vector& a, const small_vector& b) { return !(a==b); }
+    };
+}
+
 struct option {
     sink s;
-    std::vector<key> keys;
-    std::vector<filter> filters;
-    std::vector<modal> modals;
+    impl::small_vector<key, 2> keys;
+    impl::small_vector<filter, 1> filters;
+    impl::small_vector<modal, 1> modals;
 
     bool is_flag = false;
     bool is_ephemeral = false;
@@ -792,18 +3213,22 @@ struct option {
     }
 
     // Returns false (if lax) or throws on argument error.
-    bool run(const std::string& label, const char* arg) const {
+    bool run(const char* label, const char* arg) const {
         if (!is_flag && !arg) return is_lax? false: throw missing_argument(label);
         if (!s(arg)) return is_lax? false: throw option_parse_error(label);
         return true;
     }
 
+    bool run(const std::string& label, const char* arg) const {
+        return run(label.c_str(), arg);
+    }
+
     std::string longest_label() const {
-        const std::string* p = 0;
+        const key_label* p = 0;
         for (auto& k: keys) {
             if (!p || k.label.size()>p->size()) p = &k.label;
         }
-        return p? *p: std::string{};
+        return p? p->str(): std::string{};
     }
 
 private:
@@ -953,6 +3378,13 @@ struct saved_options: private std::vector<std::string> {
 // used by to::run().
 
 namespace impl {
+    // A compact key found at the current argument position, and the
+    // number of characters it occupies there.
+    struct compact_match {
+        const key* k;
+        unsigned length;
+    };
+
     struct counted_option: option {
         int count = 0;
 
@@ -961,32 +3393,294 @@ namespace impl {
         // On successful match, return pointers to matched key and argumnent.
         // For flags, use nullptr for argumnent; for empty key sets, use
         // nullptr for key.
+        //
+        // Compact keys are matched against the state directly, or if
+        // supplied, looked up in the compact keys already found at the
+        // current position.
         typedef maybe<std::pair<const char*, const char*>> maybe_keyarg;
-        maybe_keyarg match(state& st) {
+        maybe_keyarg match(state& st, const std::vector<compact_match>* found = nullptr) {
             bool empty_keyset = keys.empty();
 
-            auto try_run = [&](const std::string& label, const state::match_result& mr) -> maybe_keyarg {
+            auto try_run = [&](const char* label, const state::match_result& mr) -> maybe_keyarg {
                 if (run(label, mr.argument)) {
                     st.consume(mr);
                     ++count;
-                    return std::make_pair(empty_keyset? nullptr: label.c_str(), mr.argument);
+                    return std::make_pair(empty_keyset? nullptr: label, mr.argument);
                 }
                 return nothing;
             };
 
-            if (is_flag) {
-                for (auto& k: keys) if (auto m = st.match_flag(k)) return try_run(k.label, *m);
-            }
-            else if (!empty_keyset) {
-                for (auto& k: keys) if (auto m = st.match_option(k)) return try_run(k.label, *m);
-            }
-            else {
+            auto found_length = [found](const key& k) -> maybe<unsigned> {
+                for (auto& f: *found) if (f.k==&k) return f.length;
+                return nothing;
+            };
+
+            // A flag without keys never matches.
+            if (empty_keyset) {
+                if (is_flag) return nothing;
                 return try_run("", state::match_result{*st.argv, 1, 0});
             }
 
+            for (auto& k: keys) {
+                maybe<state::match_result> m;
+                if (found && k.style==key::compact) {
+                    if (auto n = found_length(k)) m = is_flag? st.compact_flag(*n): st.compact_option(*n);
+                }
+                else {
+                    m = is_flag? st.match_flag(k): st.match_option(k);
+                }
+
+                if (m) return try_run(k.label.c_str(), *m);
+            }
+
             return nothing;
         }
     };
+
+    // Map from key labels to the options bearing them. Entries with the
+    // same label are contiguous and in declaration order.
+    class label_table {
+        struct entry {
+            const char* label;
+            std::size_t length;
+            std::size_t hash;
+            unsigned option;
+        };
+
+        std::vector<entry> entries_;
+        std::vector<std::size_t> index_; // 0 => empty slot, else 1+position in entries_ of first entry with label.
+
+        static bool less(const entry& a, const entry& b) {
+            if (a.length!=b.length) return a.length<b.length;
+            int c = std::memcmp(a.label, b.label, a.length);
+            return c? c<0: a.option<b.option;
+        }
+
+        static bool same_label(const entry& a, const char* label, std::size_t n) {
+            return a.length==n && !std::memcmp(a.label, label, n);
+        }
+
+    public:
+        // Labels are not copied, and must outlive the table.
+        void add(const key_label& label, unsigned option) {
+            entries_.push_back({label.data(), label.size(), label.hash(), option});
+        }
+
+        void build() {
+            std::sort(entries_.begin(), entries_.end(), less);
+            entries_.erase(std::unique(entries_.begin(), entries_.end(),
+                [](const entry& a, const entry& b) { return a.option==b.option && same_label(a, b.label, b.length); }),
+                entries_.end());
+
+            index_.assign(pow2_ceil(2*entries_.size()), 0);
+            std::size_t mask = index_.size()-1;
+            for (std::size_t i = 0; i<entries_.size(); ++i) {
+                const entry& e = entries_[i];
+                if (i && same_label(entries_[i-1], e.label, e.length)) continue;
+
+                std::size_t j = e.hash&mask;
+                while (index_[j]) j = (j+1)&mask;
+                index_[j] = 1+i;
+            }
+        }
+
+        // Append to out the options with the given label.
+        void find(const char* label, std::size_t n, std::size_t hash, std::vector<unsigned>& out) const {
+            if (entries_.empty()) return;
+
+            std::size_t mask = index_.size()-1;
+            for (std::size_t j = hash&mask; index_[j]; j = (j+1)&mask) {
+                std::size_t i = index_[j]-1;
+                if (!same_label(entries_[i], label, n)) continue;
+
+                for (; i<entries_.size() && same_label(entries_[i], label, n); ++i) {
+                    out.push_back(entries_[i].option);
+                }
+                return;
+            }
+        }
+
+        void find(const char* label, std::size_t n, std::vector<unsigned>& out) const {
+            find(label, n, hash_bytes(label, n), out);
+        }
+    };
+
+    // Prefix trie over the compact keys of a collection of options.
+    //
+    // A compact key matches at the current position if, for some l, its
+    // first l characters begin the argument and the remainder follows the
+    // current position; the smallest such l determines the length of the
+    // match (see state::match_compact_key). find() walks the trie from the
+    // node for each such l along the text at the current position, finding
+    // every matching compact key in one pass.
+    //
+    // Children of a node are kept in a sibling list, or once a node has
+    // more than a few children, in a 256-entry table. In particular the
+    // children of "-" for a set of single-character "-x" compact flags
+    // will be found by a single table lookup.
+    class compact_trie {
+        static constexpr unsigned none = -1;
+        static constexpr unsigned list_max = 4;
+
+        struct node {
+            unsigned child = none;
+            unsigned sibling = none;
+            unsigned table = none;  // Index into tables_, if any.
+            unsigned n_child = 0;
+            unsigned keys = none;   // First key ending at this node, by position in keys_.
+            unsigned char c = 0;
+        };
+
+        struct key_entry {
+            unsigned option;
+            const key* k;
+            unsigned next;          // Next key with the same label.
+        };
+
+        std::vector<node> nodes_;
+        std::vector<std::array<unsigned, 256>> tables_;
+        std::vector<key_entry> keys_;
+
+        unsigned child(unsigned n, unsigned char c) const {
+            const node& x = nodes_[n];
+            if (x.table!=none) return tables_[x.table][c];
+
+            unsigned i = x.child;
+            while (i!=none && nodes_[i].c!=c) i = nodes_[i].sibling;
+            return i;
+        }
+
+        unsigned add_child(unsigned n, unsigned char c) {
+            unsigned i = nodes_.size();
+            nodes_.emplace_back();
+            nodes_[i].c = c;
+            nodes_[i].sibling = nodes_[n].child;
+            nodes_[n].child = i;
+
+            if (nodes_[n].table!=none) {
+                tables_[nodes_[n].table][c] = i;
+            }
+            else if (++nodes_[n].n_child>list_max) {
+                nodes_[n].table = tables_.size();
+                tables_.emplace_back();
+                for (auto& t: tables_.back()) t = none;
+                for (unsigned j = nodes_[n].child; j!=none; j = nodes_[j].sibling) {
+                    tables_.back()[nodes_[j].c] = j;
+                }
+            }
+            return i;
+        }
+
+    public:
+        compact_trie(): nodes_(1) {}
+
+        bool empty() const { return keys_.empty(); }
+
+        // Keys are not copied, and must outlive the trie. Keys with the same
+        // label must be added in declaration order.
+        void add(unsigned option, const key& k) {
+            unsigned n = 0;
+            for (unsigned char c: k.label) {
+                unsigned i = child(n, c);
+                n = i==none? add_child(n, c): i;
+            }
+
+            unsigned e = keys_.size();
+            keys_.push_back({option, &k, none});
+
+            unsigned* tail = &nodes_[n].keys;
+            while (*tail!=none) tail = &keys_[*tail].next;
+            *tail = e;
+        }
+
+        // Append to found the compact keys that match at the current
+        // position, and to options the options that bear them.
+        void find(const state& st, std::vector<compact_match>& found, std::vector<unsigned>& options) const {
+            const char* arg = *st.argv;
+            const char* text = arg+st.optoff;
+
+            unsigned n = 0;
+            for (unsigned l = 0; l<=st.optoff; n = child(n, arg[l++])) {
+                if (n==none) return;
+
+                unsigned m = n;
+                for (const char* p = text; *p && (m = child(m, *p))!=none; ) {
+                    ++p;
+                    for (unsigned e = nodes_[m].keys; e!=none; e = keys_[e].next) {
+                        const key* k = keys_[e].k;
+                        bool seen = false;
+                        for (auto& f: found) if (f.k==k) seen = true;
+                        if (seen) continue;
+
+                        found.push_back({k, static_cast<unsigned>(p-text)});
+                        options.push_back(keys_[e].option);
+                    }
+                }
+            }
+        }
+    };
+
+    // Index over the keyed options in a collection, used by impl::run to
+    // find the options that could match the current argument without
+    // trying every key of every option.
+    //
+    // Short and long keys are looked up by the whole argument; long keys of
+    // options that take a parameter are also looked up by the text before
+    // any '=' in the argument. Compact keys are found with a compact_trie.
+    // The options without keys are listed separately, in declaration order.
+    //
+    // The index refers to the options' keys, and must not outlive them.
+    class option_index {
+        label_table exact_;
+        label_table assign_;
+        compact_trie compact_;
+        std::vector<unsigned> keyless_;
+
+    public:
+        explicit option_index(const std::vector<counted_option>& opts) {
+            for (unsigned i = 0; i<opts.size(); ++i) {
+                const auto& o = opts[i];
+                if (o.keys.empty()) keyless_.push_back(i);
+                for (const auto& k: o.keys) {
+                    if (k.style==key::compact) {
+                        compact_.add(i, k);
+                        continue;
+                    }
+                    exact_.add(k.label, i);
+                    if (k.style==key::longfmt && !o.is_flag) assign_.add(k.label, i);
+                }
+            }
+            exact_.build();
+            assign_.build();
+        }
+
+        // Indices of the options without keys, in declaration order.
+        const std::vector<unsigned>& keyless() const { return keyless_; }
+
+        // Set out to the indices of the options that might match the
+        // current argument, in declaration order, and found to the compact
+        // keys that match at the current position.
+        void candidates(const state& st, std::vector<unsigned>& out, std::vector<compact_match>& found) const {
+            out.clear();
+            found.clear();
+            if (!st.optoff) {
+                const char* arg = *st.argv;
+                std::size_t n = 0;
+                std::size_t h = hash_cstr(arg, n);
+                exact_.find(arg, n, h, out);
+
+                for (const char* eq = std::strchr(arg, '='); eq; eq = std::strchr(eq+1, '=')) {
+                    assign_.find(arg, eq-arg, out);
+                }
+            }
+
+            if (!compact_.empty()) compact_.find(st, found, out);
+            if (out.size()>1) {
+                std::sort(out.begin(), out.end());
+                out.erase(std::unique(out.begin(), out.end()), out.end());
+            }
+        }
+    };
 } // namespace impl
 
 // Running a set of options
@@ -1005,20 +3699,22 @@ namespace impl {
 // options.
 
 namespace impl {
-    inline maybe<saved_options> run(std::vector<impl::counted_option>& opts, int& argc, char** argv) {
+    inline maybe<saved_options> run(std::vector<impl::counted_option>& opts, const option_index& index, state& st) {
         saved_options collate;
         bool exit = false;
         bool stop = false;
-        state st{argc, argv};
         int mode = 0;
+        std::vector<unsigned> candidates;
+        std::vector<compact_match> found;
         while (st && !exit && !stop) {
             // Try options with a key first.
-            for (auto& o: opts) {
-                if (o.keys.empty()) continue;
+            index.candidates(st, candidates, found);
+            for (unsigned i: candidates) {
+                auto& o = opts[i];
                 if (o.is_single && o.count) continue;
                 if (!o.check_mode(mode)) continue;
 
-                if (auto ma = o.match(st)) {
+                if (auto ma = o.match(st, &found)) {
                     if (!o.is_ephemeral) {
                         if (ma->first) collate.add(ma->first);
                         if (ma->second) collate.add(ma->second);
@@ -1030,15 +3726,16 @@ namespace impl {
                 }
             }
 
-            // Literal "--" terminates option parsing.
-            if (!std::strcmp(*argv, "--")) {
+            // Literal "--" terminates option parsing, if no argument
+            // has been left unmatched before it.
+            if (!st.skipped && !std::strcmp(*st.argv, "--")) {
                 st.shift();
                 return collate;
             }
 
             // Try free options.
-            for (auto& o: opts) {
-                if (!o.keys.empty()) continue;
+            for (unsigned i: index.keyless()) {
+                auto& o = opts[i];
                 if (o.is_single && o.count) continue;
                 if (!o.check_mode(mode)) continue;
 
@@ -1057,25 +3754,72 @@ namespace impl {
 
         return exit? nothing: just(collate);
     }
-} // namespace impl
 
+    // Remove matched arguments from argv, compacting it on return.
+    inline maybe<saved_options> run(std::vector<impl::counted_option>& opts, const option_index& index, int& argc, char** argv) {
+        state st{argc, argv};
+        st.defer();
+
+        struct compact_on_exit {
+            state& st;
+            ~compact_on_exit() { st.compact(); }
+        } guard{st};
 
-template <typename Options>
-maybe<saved_options> run(const Options& options, int& argc, char** argv, const saved_options& restore = saved_options{}) {
-    using std::begin;
-    using std::end;
-    std::vector<impl::counted_option> opts(begin(options), end(options));
-    auto r_args = restore.as_arglist();
+        return run(opts, index, st);
+    }
+
+    inline maybe<saved_options> run(std::vector<impl::counted_option>& opts, int& argc, char** argv) {
+        return run(opts, option_index(opts), argc, argv);
+    }
+
+    // Leave argv unmodified, and set remaining to the arguments that would
+    // otherwise be left in argv: those unmatched, followed by any that
+    // remain unprocessed.
+    inline maybe<saved_options> run(std::vector<impl::counted_option>& opts, const option_index& index, const char* const* argv, arg_span& remaining) {
+        int ignore_argc = 0;
+        // The state does not write to the argument list when recording.
+        state st{ignore_argc, const_cast<char**>(argv)};
+        remaining = arg_span(argv);
+        st.record(remaining);
+
+        auto result = run(opts, index, st);
+
+        const char* const* unprocessed = st.argv;
+        std::size_t b = unprocessed-argv, e = b;
+        while (argv[e]) ++e;
+        remaining.append(b, e);
+        return result;
+    }
+
+    // Run options over the arguments restored from saved options and then
+    // those processed by run_args, checking mandatory options are present.
+    template <typename Options, typename RunArgs>
+    maybe<saved_options> run_options(const Options& options, const saved_options& restore, RunArgs run_args) {
+        using std::begin;
+        using std::end;
+        std::vector<impl::counted_option> opts(begin(options), end(options));
+        option_index index(opts);
+        auto r_args = restore.as_arglist();
 
-    saved_options coll1, coll2;
-    if (coll1 << impl::run(opts, r_args.argc, r_args.argv) && coll2 << impl::run(opts, argc, argv)) {
-        for (auto& o: opts) {
-            if (o.is_mandatory && !o.count) throw missing_mandatory_option(o.longest_label());
+        saved_options coll1, coll2;
+        if (coll1 << run(opts, index, r_args.argc, r_args.argv) && coll2 << run_args(opts, index)) {
+            for (auto& o: opts) {
+                if (o.is_mandatory && !o.count) throw missing_mandatory_option(o.longest_label());
+            }
+            return coll1 += coll2;
         }
-        return coll1 += coll2;
+
+        return nothing;
     }
+} // namespace impl
 
-    return nothing;
+
+template <typename Options>
+maybe<saved_options> run(const Options& options, int& argc, char** argv, const saved_options& restore = saved_options{}) {
+    return impl::run_options(options, restore,
+        [&](std::vector<impl::counted_option>& opts, const impl::option_index& index) {
+            return impl::run(opts, index, argc, argv);
+        });
 }
 
 template <typename Options>
@@ -1097,6 +3841,23 @@ maybe<saved_options> run(const Options& options, char** argv, const saved_option
     return run(options, ignore_argc, argv, restore);
 }
 
+// Run without modifying argv: remaining is set to the arguments that would
+// otherwise be left in argv, as a span over argv.
+
+template <typename Options>
+maybe<saved_options> run(const Options& options, const char* const* argv, arg_span& remaining, const saved_options& restore = saved_options{}) {
+    // If option processing exits while restoring, no argument is processed.
+    remaining = arg_span(argv);
+    std::size_t n = 0;
+    while (argv[n]) ++n;
+    remaining.append(0, n);
+
+    return impl::run_options(options, restore,
+        [&](std::vector<impl::counted_option>& opts, const impl::option_index& index) {
+            return impl::run(opts, index, argv, remaining);
+        });
+}
+
 // Running through command line arguments explicitly.
 // --------------------------------------------------
 //
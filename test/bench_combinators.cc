@@ -0,0 +1,84 @@
+// Compare a parser built with combinators against the equivalent
+// hand-written parser, and against the same composition type-erased
+// behind std::function.
+//
+// Usage: bench_combinators [PARSES]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <tinyopt/tinyopt.h>
+
+constexpr to::keyword_entry<int> levels[] = {{"auto", -1}, {"none", 0}};
+constexpr auto level_keywords = to::keywords(levels);
+
+// Accepts "auto", "none", or an integer from 1 to 9.
+struct hand_written {
+    to::maybe<int> operator()(const char* text) const {
+        if (auto v = level_keywords(text)) return v;
+        auto n = to::default_parser<int>{}(text);
+        if (n && *n>=1 && *n<=9) return n;
+        return to::nothing;
+    }
+};
+
+auto combined() {
+    return level_keywords | to::in_range(to::default_parser<int>{}, 1, 9);
+}
+
+std::function<to::maybe<int> (const char*)> type_erased() {
+    std::function<to::maybe<int> (const char*)> kw = level_keywords;
+    std::function<to::maybe<int> (const char*)> num = to::default_parser<int>{};
+    std::function<bool (int)> check = [](int n) { return n>=1 && n<=9; };
+    return [=](const char* text) -> to::maybe<int> {
+        if (auto v = kw(text)) return v;
+        auto n = num(text);
+        if (n && check(*n)) return n;
+        return to::nothing;
+    };
+}
+
+// Best of several runs.
+template <typename Parser>
+double ns_per_parse(const Parser& parser, const std::vector<std::string>& args, long& checksum) {
+    using clock = std::chrono::steady_clock;
+
+    double best = 0;
+    for (int i = 0; i<5; ++i) {
+        auto t0 = clock::now();
+        for (const auto& a: args) {
+            if (auto v = parser(a.c_str())) checksum += *v;
+            else --checksum;
+        }
+        auto t1 = clock::now();
+
+        double t = std::chrono::duration<double, std::nano>(t1-t0).count()/args.size();
+        if (!i || t<best) best = t;
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    std::size_t n = argc>1? std::atol(argv[1]): 1000000;
+
+    const char* samples[] = {"auto", "none", "1", "5", "9", "10", "x"};
+    std::minstd_rand R;
+    std::uniform_int_distribution<std::size_t> U(0, sizeof(samples)/sizeof(*samples)-1);
+
+    std::vector<std::string> args;
+    for (std::size_t i = 0; i<n; ++i) args.push_back(samples[U(R)]);
+
+    long checksum = 0;
+    double t_hand = ns_per_parse(hand_written{}, args, checksum);
+    double t_comb = ns_per_parse(combined(), args, checksum);
+    double t_func = ns_per_parse(type_erased(), args, checksum);
+
+    std::printf("%12s %12s %12s\n", "hand/ns", "combined/ns", "function/ns");
+    std::printf("%12.2f %12.2f %12.2f\n", t_hand, t_comb, t_func);
+    std::printf("(checksum %ld)\n", checksum);
+}
@@ -0,0 +1,85 @@
+// Compare parsing of long comma-separated integer lists by the
+// delimited<Int>() fast path against the generic delimited_parser
+// with a per-element parser.
+//
+// Usage: bench_delimited [ELEMENTS]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <tinyopt/tinyopt.h>
+
+// Wraps the default parser so that delimited_parser takes its generic path,
+// splitting at delimiters and handing each element over as a range.
+template <typename V>
+struct range_parser {
+    to::default_parser<V> p;
+    to::maybe<V> operator()(const char* s) const { return p(s); }
+    to::maybe<V> operator()(const char* b, const char* e) const { return p(b, e); }
+};
+
+// Accepts only NUL-terminated elements, so each is copied before parsing.
+template <typename V>
+struct cstr_parser {
+    to::default_parser<V> p;
+    to::maybe<V> operator()(const char* s) const { return p(s); }
+};
+
+// Best of several runs.
+template <typename Parser>
+double ns_per_element(const Parser& parser, const std::string& text, std::size_t n, long long& checksum) {
+    using clock = std::chrono::steady_clock;
+
+    double best = 0;
+    for (int i = 0; i<5; ++i) {
+        auto t0 = clock::now();
+        auto values = parser(text.c_str());
+        auto t1 = clock::now();
+
+        if (!values || values->size()!=n) {
+            std::fprintf(stderr, "parse failure\n");
+            std::exit(1);
+        }
+        for (auto v: *values) checksum += v;
+
+        double t = std::chrono::duration<double, std::nano>(t1-t0).count()/n;
+        if (!i || t<best) best = t;
+    }
+    return best;
+}
+
+template <typename Int>
+void run(const char* label, std::size_t n, Int max, long long& checksum) {
+    std::minstd_rand R;
+    std::uniform_int_distribution<Int> U(0, max);
+
+    std::string text;
+    for (std::size_t i = 0; i<n; ++i) {
+        if (i) text += ',';
+        text += std::to_string(U(R));
+    }
+
+    double t_fast = ns_per_element(to::delimited<Int>(), text, n, checksum);
+    double t_range = ns_per_element(to::delimited(',', range_parser<Int>{}), text, n, checksum);
+    double t_cstr = ns_per_element(to::delimited(',', cstr_parser<Int>{}), text, n, checksum);
+
+    std::printf("%-20s %10zu %12.2f %12.2f %12.2f\n", label, text.size(), t_fast, t_range, t_cstr);
+}
+
+int main(int argc, char** argv) {
+    std::size_t n = argc>1? std::atol(argv[1]): 1000000;
+    long long checksum = 0;
+
+    std::printf("%-20s %10s %12s %12s %12s\n", "elements", "bytes", "fast/ns", "range/ns", "copy/ns");
+    run<int>("int [0, 999]", n, 999, checksum);
+    run<int>("int [0, 2^31)", n, std::numeric_limits<int>::max(), checksum);
+    run<std::uint64_t>("uint64_t [0, 2^64)", n, std::numeric_limits<std::uint64_t>::max(), checksum);
+
+    std::printf("(checksum %lld)\n", checksum);
+}
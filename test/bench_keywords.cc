@@ -0,0 +1,57 @@
+// Compare keyword_parser lookup by linear scan and by hashed index
+// over a range of table sizes.
+//
+// Usage: bench_keywords [LOOKUPS]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <tinyopt/tinyopt.h>
+
+template <typename Parser>
+double ns_per_lookup(const Parser& parser, const std::vector<std::string>& queries, long& checksum) {
+    using clock = std::chrono::steady_clock;
+
+    auto t0 = clock::now();
+    for (const auto& q: queries) {
+        if (auto v = parser(q.c_str())) checksum += *v;
+    }
+    auto t1 = clock::now();
+
+    return std::chrono::duration<double, std::nano>(t1-t0).count()/queries.size();
+}
+
+int main(int argc, char** argv) {
+    std::size_t n_lookup = argc>1? std::atol(argv[1]): 1000000;
+    std::minstd_rand R;
+    long checksum = 0;
+
+    std::printf("%8s %12s %12s\n", "entries", "linear/ns", "hashed/ns");
+    for (std::size_t n: {1, 2, 4, 6, 8, 12, 16, 32, 64, 256, 1024, 4096}) {
+        std::vector<std::pair<std::string, int>> table;
+        for (std::size_t i = 0; i<n; ++i) {
+            table.push_back({"keyword-"+std::to_string(i*7919%100003), (int)i});
+        }
+
+        // Lookups are of present keys, with one in eight a miss.
+        std::uniform_int_distribution<std::size_t> U(0, n-1);
+        std::vector<std::string> queries;
+        for (std::size_t i = 0; i<n_lookup; ++i) {
+            queries.push_back(i%8? table[U(R)].first: "keyword-absent");
+        }
+
+        to::keyword_parser<int> linear(table, n);
+        to::keyword_parser<int> hashed(table, 0);
+
+        double t_linear = ns_per_lookup(linear, queries, checksum);
+        double t_hashed = ns_per_lookup(hashed, queries, checksum);
+        std::printf("%8zu %12.2f %12.2f\n", n, t_linear, t_hashed);
+    }
+
+    std::printf("(checksum %ld)\n", checksum);
+}
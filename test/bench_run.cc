@@ -0,0 +1,141 @@
+// Time to::run over generated option tables and argument lists, reporting
+// the cost per command line argument for a range of table sizes, for
+// clusters of compact flags, and for argument lists of increasing length.
+//
+// Usage: bench_run [ARGUMENTS]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <tinyopt/tinyopt.h>
+
+int main(int argc, char** argv) {
+    using clock = std::chrono::steady_clock;
+
+    std::size_t n_arg = argc>1? std::atol(argv[1]): 20000;
+    std::minstd_rand R;
+    long checksum = 0;
+
+    std::printf("%8s %10s %12s\n", "options", "arguments", "ns/argument");
+    for (std::size_t n: {1, 4, 16, 64, 256, 1024}) {
+        // Half the options take an integer parameter, half are flags; each
+        // has a short and a long key.
+        std::vector<long> values(n);
+        std::vector<to::option> opts;
+        for (std::size_t i = 0; i<n; ++i) {
+            std::string s = "-o"+std::to_string(i), l = "--option-"+std::to_string(i);
+            if (i%2) opts.push_back({to::increment(values[i]), s, l, to::flag});
+            else opts.push_back({values[i], s, l});
+        }
+
+        // Mix of short, long and --key=value forms, with one in eight
+        // arguments unmatched.
+        std::uniform_int_distribution<std::size_t> U(0, n-1);
+        std::vector<std::string> args;
+        for (std::size_t i = 0; args.size()<n_arg; ++i) {
+            std::size_t j = U(R);
+            std::string v = std::to_string(i%1000);
+            switch (i%8) {
+            case 0: args.push_back("positional"); break;
+            case 1: case 2: case 3:
+                args.push_back("-o"+std::to_string(j));
+                if (!(j%2)) args.push_back(v);
+                break;
+            default:
+                if (j%2) args.push_back("--option-"+std::to_string(j));
+                else args.push_back("--option-"+std::to_string(j)+"="+v);
+            }
+        }
+
+        std::vector<char*> av;
+        for (auto& a: args) av.push_back(&a[0]);
+        av.push_back(nullptr);
+        int ac = av.size()-1;
+
+        auto t0 = clock::now();
+        auto saved = to::run(opts, ac, av.data());
+        auto t1 = clock::now();
+
+        if (!saved) {
+            std::fprintf(stderr, "run failure\n");
+            return 1;
+        }
+        checksum += ac;
+        for (auto v: values) checksum += v;
+
+        double t = std::chrono::duration<double, std::nano>(t1-t0).count()/args.size();
+        std::printf("%8zu %10zu %12.2f\n", n, args.size(), t);
+    }
+
+    // Clusters of single-character compact flags, e.g. -vvxq.
+    std::printf("\n%8s %10s %12s\n", "compact", "arguments", "ns/argument");
+    for (std::size_t n: {4, 16, 52}) {
+        const char* letters = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+        std::vector<long> counts(n);
+        std::vector<to::option> opts;
+        for (std::size_t i = 0; i<n; ++i) {
+            opts.push_back({to::increment(counts[i]), to::key(std::string{'-', letters[i]}, to::key::compact), to::flag});
+        }
+
+        std::uniform_int_distribution<std::size_t> U(0, n-1);
+        std::vector<std::string> args;
+        while (args.size()<n_arg) {
+            std::string a = "-";
+            for (int j = 0; j<8; ++j) a += letters[U(R)];
+            args.push_back(a);
+        }
+
+        std::vector<char*> av;
+        for (auto& a: args) av.push_back(&a[0]);
+        av.push_back(nullptr);
+        int ac = av.size()-1;
+
+        auto t0 = clock::now();
+        auto saved = to::run(opts, ac, av.data());
+        auto t1 = clock::now();
+
+        if (!saved) {
+            std::fprintf(stderr, "run failure\n");
+            return 1;
+        }
+        for (auto c: counts) checksum += c;
+
+        double t = std::chrono::duration<double, std::nano>(t1-t0).count()/args.size();
+        std::printf("%8zu %10zu %12.2f\n", n, args.size(), t);
+    }
+
+    // Argument lists of increasing length, half of which are consumed; the
+    // cost per argument should not grow with the length of the list.
+    std::printf("\n%8s %10s %12s\n", "length", "arguments", "ns/argument");
+    for (std::size_t n: {n_arg/4, n_arg, 4*n_arg}) {
+        long k = 0;
+        to::option opts[] = {{to::increment(k), "-k", to::flag, to::ephemeral}};
+
+        std::vector<std::string> args;
+        for (std::size_t i = 0; i<n; ++i) args.push_back(i%2? "-k": "x");
+
+        std::vector<char*> av;
+        for (auto& a: args) av.push_back(&a[0]);
+        av.push_back(nullptr);
+        int ac = av.size()-1;
+
+        auto t0 = clock::now();
+        auto saved = to::run(opts, ac, av.data());
+        auto t1 = clock::now();
+
+        if (!saved) {
+            std::fprintf(stderr, "run failure\n");
+            return 1;
+        }
+        checksum += ac+k;
+
+        double t = std::chrono::duration<double, std::nano>(t1-t0).count()/args.size();
+        std::printf("%8zu %10zu %12.2f\n", n, args.size(), t);
+    }
+
+    std::printf("(checksum %ld)\n", checksum);
+}
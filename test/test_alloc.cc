@@ -0,0 +1,52 @@
+// Allocation checks, built as a separate executable (unit-alloc) so that
+// the replacement of the global operator new and operator delete below
+// does not affect the other unit tests.
+
+#include <cstdlib>
+#include <new>
+
+#include <gtest/gtest.h>
+#include <tinyopt/tinyopt.h>
+
+// Count calls to (non-aligned) global operator new made while an
+// allocation_counter is in scope.
+namespace {
+std::size_t* alloc_count = nullptr;
+
+struct allocation_counter {
+    std::size_t n = 0;
+    allocation_counter() { alloc_count = &n; }
+    ~allocation_counter() { alloc_count = nullptr; }
+};
+}
+
+void* operator new(std::size_t n) {
+    if (alloc_count) ++*alloc_count;
+    if (void* p = std::malloc(n? n: 1)) return p;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+TEST(option, no_allocation) {
+    using namespace to::literals;
+    int n = 0, v = 0;
+    bool x = false;
+
+    std::size_t n_alloc = 0;
+    {
+        allocation_counter count;
+        {
+            to::option opts[] = {
+                {n, "-n", "--number", to::single},
+                {to::increment(v), "-v"_compact, "--verbose"_long, to::flag, to::ephemeral},
+                {to::set(x), "--a-rather-long-option-name"_long, to::flag, to::when(1), to::then(0)}
+            };
+            to::option copy = opts[1];
+            EXPECT_EQ(2u, copy.keys.size());
+        }
+        n_alloc = count.n;
+    }
+    EXPECT_EQ(0u, n_alloc);
+}
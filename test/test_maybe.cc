@@ -1,3 +1,12 @@
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if __cplusplus>=201703
+#include <optional>
+#endif
+
 #include <gtest/gtest.h>
 
 #include <tinyopt/tinyopt.h>
@@ -150,3 +159,148 @@ TEST(maybe, conv) {
     EXPECT_TRUE(d);
     EXPECT_EQ(1., d.value());
 }
+
+namespace {
+struct throwing_move {
+    throwing_move() = default;
+    throwing_move(const throwing_move&) {}
+    throwing_move(throwing_move&&) noexcept(false) {}
+    throwing_move& operator=(const throwing_move&) { return *this; }
+    throwing_move& operator=(throwing_move&&) noexcept(false) { return *this; }
+};
+
+struct nothrow_move {
+    nothrow_move() = default;
+    nothrow_move(const nothrow_move&) {}
+    nothrow_move(nothrow_move&&) noexcept {}
+    nothrow_move& operator=(const nothrow_move&) { return *this; }
+    nothrow_move& operator=(nothrow_move&&) noexcept { return *this; }
+};
+
+template <typename T>
+struct matches_triviality: std::integral_constant<bool,
+    std::is_trivially_copyable<maybe<T>>::value==std::is_trivially_copyable<T>::value &&
+    std::is_trivially_destructible<maybe<T>>::value==std::is_trivially_destructible<T>::value> {};
+}
+
+TEST(maybe, trivial) {
+    static_assert(std::is_trivially_copyable<maybe<int>>::value, "");
+    static_assert(std::is_trivially_copyable<maybe<double>>::value, "");
+    static_assert(std::is_trivially_copyable<maybe<const char*>>::value, "");
+    static_assert(std::is_trivially_destructible<maybe<int>>::value, "");
+    static_assert(!std::is_trivially_copyable<maybe<std::string>>::value, "");
+    static_assert(!std::is_trivially_destructible<maybe<std::string>>::value, "");
+
+    static_assert(matches_triviality<int>::value, "");
+    static_assert(matches_triviality<std::string>::value, "");
+    static_assert(matches_triviality<std::vector<int>>::value, "");
+    static_assert(matches_triviality<throwing_move>::value, "");
+
+    static_assert(std::is_nothrow_move_constructible<maybe<std::string>>::value, "");
+    static_assert(std::is_nothrow_move_assignable<maybe<std::string>>::value, "");
+    static_assert(std::is_nothrow_move_constructible<maybe<nothrow_move>>::value, "");
+    static_assert(!std::is_nothrow_move_constructible<maybe<throwing_move>>::value, "");
+    static_assert(!std::is_nothrow_move_assignable<maybe<throwing_move>>::value, "");
+
+#if __cplusplus>=201703
+    // Same layout and copy semantics as std::optional, so that maybe<T> is
+    // passed and returned in registers whenever std::optional<T> is.
+    static_assert(sizeof(maybe<int>)==sizeof(std::optional<int>), "");
+    static_assert(sizeof(maybe<double>)==sizeof(std::optional<double>), "");
+    static_assert(std::is_trivially_copyable<maybe<int>>::value==std::is_trivially_copyable<std::optional<int>>::value, "");
+    static_assert(std::is_trivially_copyable<maybe<std::string>>::value==std::is_trivially_copyable<std::optional<std::string>>::value, "");
+#endif
+
+    // Trivially copyable maybe values can be copied bytewise.
+    std::vector<maybe<int>> v = {3, nothing, 5};
+    maybe<int> w[3];
+    std::memcpy(w, v.data(), sizeof(w));
+    EXPECT_EQ(3, w[0].value());
+    EXPECT_FALSE(w[1]);
+    EXPECT_EQ(5, w[2].value());
+}
+
+TEST(maybe, constexpr) {
+    constexpr maybe<int> a;
+    constexpr maybe<int> b(nothing);
+    constexpr maybe<int> c(3);
+    constexpr maybe<int> d = c;
+
+    static_assert(!a && !b.has_value(), "");
+    static_assert(c && *c==3 && c.value()==3, "");
+    static_assert(d.has_value() && *d==3, "");
+
+    constexpr maybe<double> e = just(2.5);
+    static_assert(*e==2.5, "");
+    EXPECT_TRUE(d);
+}
+
+namespace {
+// Counts copies made of a value through to its destination.
+struct copy_count {
+    static int copies;
+
+    int n = 0;
+
+    copy_count() = default;
+    explicit copy_count(int n): n(n) {}
+    copy_count(const copy_count& x): n(x.n) { ++copies; }
+    copy_count(copy_count&&) = default;
+    copy_count& operator=(const copy_count& x) { n = x.n; ++copies; return *this; }
+    copy_count& operator=(copy_count&&) = default;
+};
+
+int copy_count::copies = 0;
+}
+
+TEST(maybe, move_apply) {
+    copy_count::copies = 0;
+
+    int total = 0;
+    auto consume = [&total](copy_count c) { total += c.n; };
+    auto twice = [](copy_count c) { c.n *= 2; return c; };
+
+    EXPECT_TRUE(consume << maybe<copy_count>(copy_count(3)));
+    EXPECT_EQ(3, total);
+
+    auto r = twice << maybe<copy_count>(copy_count(4));
+    ASSERT_TRUE(r);
+    EXPECT_EQ(8, r->n);
+
+    copy_count x;
+    EXPECT_TRUE(x << maybe<copy_count>(copy_count(5)));
+    EXPECT_EQ(5, x.n);
+    EXPECT_EQ(1, copy_count::copies); // Copy of x returned by x << m.
+
+    maybe<copy_count> m(copy_count(6));
+    EXPECT_TRUE(consume << m);
+    EXPECT_EQ(2, copy_count::copies);
+    EXPECT_TRUE(consume << std::move(m));
+    EXPECT_EQ(2, copy_count::copies);
+}
+
+TEST(maybe, emplace) {
+    copy_count::copies = 0;
+
+    maybe<copy_count> a(in_place, 7);
+    ASSERT_TRUE(a);
+    EXPECT_EQ(7, a->n);
+
+    maybe<copy_count> b;
+    copy_count& c = b.emplace(8);
+    EXPECT_EQ(8, b->n);
+    EXPECT_EQ(&c, &*b);
+    b.emplace(9);
+    EXPECT_EQ(9, b.value().n);
+
+    maybe<std::string> s;
+    s.emplace(3, 'x');
+    EXPECT_EQ("xxx", *s);
+    s->append("y");
+    EXPECT_EQ("xxxy", s.value());
+
+    constexpr maybe<int> d(in_place, 4);
+    static_assert(*d==4, "");
+
+    EXPECT_EQ(0, copy_count::copies);
+}
@@ -107,6 +107,84 @@ TEST(option, ctor) {
     EXPECT_EQ((svec{}), key_labels(opts[7]));
 }
 
+TEST(key, label) {
+    using namespace to::literals;
+
+    const char* text = "--static";
+    to::key a(to::key_label(to::key_label::static_t{}, text, 8));
+    EXPECT_EQ(text, a.label.data());
+    EXPECT_EQ(to::key::longfmt, a.style);
+
+    auto b = "-b"_short;
+    auto c = b;
+    EXPECT_EQ(b.label.data(), c.label.data());
+
+    std::string long_label(40, 'x');
+    to::key d(long_label);
+    to::key e(d);
+    EXPECT_NE(long_label.data(), d.label.data());
+    EXPECT_NE(d.label.data(), e.label.data());
+    EXPECT_EQ(long_label, e.label);
+
+    to::key f(std::move(e));
+    EXPECT_EQ(long_label, f.label);
+    EXPECT_EQ(long_label.size(), f.label.size());
+    EXPECT_EQ(to::impl::hash_bytes(long_label.data(), long_label.size()), f.label.hash());
+
+    // Moved-from labels are empty.
+    EXPECT_TRUE(e.label.empty());
+    EXPECT_EQ("", e.label);
+    EXPECT_EQ(to::key_label(""s).hash(), e.label.hash());
+
+    to::key g("-g");
+    g = std::move(f);
+    EXPECT_EQ(long_label, g.label);
+    EXPECT_TRUE(f.label.empty());
+    EXPECT_EQ(""s, f.label.str());
+
+    EXPECT_TRUE("-b"==b.label);
+    EXPECT_TRUE(b.label!="-bb");
+    EXPECT_TRUE(b.label!="-");
+    EXPECT_TRUE(b.label==std::string("-b"));
+    EXPECT_EQ("-b"s, std::string(b.label));
+}
+
+TEST(option, many_keys) {
+    int n = 0;
+
+    // Keys beyond those held inline spill to the heap.
+    to::option many{n, "-a", "-b", "-c", "--dee"};
+    to::option moved = std::move(many);
+    ASSERT_EQ(4u, moved.keys.size());
+    EXPECT_EQ("-a", moved.keys[0].label);
+    EXPECT_EQ("--dee", moved.keys[3].label);
+    EXPECT_EQ("--dee"s, moved.longest_label());
+
+    // Keys can be modified as with a std::vector, and converted to and from one.
+    auto labels = [](const to::option& o) {
+        std::string s;
+        for (auto& k: o.keys) s += k.label.str()+" ";
+        return s;
+    };
+
+    moved.keys.erase(moved.keys.begin()+1);
+    EXPECT_EQ("-a -c --dee "s, labels(moved));
+    moved.keys.insert(moved.keys.begin(), to::key("-z"));
+    EXPECT_EQ("-z -a -c --dee "s, labels(moved));
+    moved.keys.erase(moved.keys.begin()+1, moved.keys.end()-1);
+    EXPECT_EQ("-z --dee "s, labels(moved));
+
+    std::vector<to::key> keys = moved.keys;
+    keys.emplace_back("-y");
+    moved.keys = keys;
+    EXPECT_EQ("-z --dee -y "s, labels(moved));
+    moved.keys.insert(moved.keys.begin()+1, keys.begin(), keys.begin()+2);
+    EXPECT_EQ("-z -z --dee --dee -y "s, labels(moved));
+    moved.keys.assign({to::key("-q")});
+    EXPECT_EQ("-q "s, labels(moved));
+    EXPECT_THROW(moved.keys.at(1), std::out_of_range);
+}
+
 TEST(option, longest_label) {
     bool x;
     to::option a(x);
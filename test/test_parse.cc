@@ -135,3 +135,25 @@ TEST(parse, custom_parser) {
         EXPECT_THROW(to::parse<bool>(arg, custom, "-s"), to::option_parse_error);
     }
 }
+
+TEST(parse, no_copies) {
+    struct copy_count {
+        int* copies;
+        std::vector<int> data;
+
+        copy_count(int* copies, std::size_t n): copies(copies), data(n) {}
+        copy_count(const copy_count& x): copies(x.copies), data(x.data) { ++*copies; }
+        copy_count(copy_count&&) = default;
+    };
+
+    int copies = 0;
+    auto parser = [&copies](const char* s) { return to::just(copy_count(&copies, std::strlen(s))); };
+
+    mockargs M("-v\0abcd\0");
+    char** arg = M.argv;
+
+    auto r = to::parse<copy_count>(arg, parser, "-v");
+    ASSERT_TRUE(r);
+    EXPECT_EQ(4u, r->data.size());
+    EXPECT_EQ(0, copies);
+}
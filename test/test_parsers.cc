@@ -1,10 +1,27 @@
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <sstream>
 #include <string>
+#include <tuple>
 #include <vector>
 
+#if __cplusplus>=201703
+#include <string_view>
+#endif
+
 #include <gtest/gtest.h>
 #include <tinyopt/tinyopt.h>
+#include <tinyopt/mapped.h>
 
 using namespace std::literals;
 
@@ -39,6 +56,61 @@ TEST(tinyopt, default_parser) {
     EXPECT_EQ(-123, *p8);
 }
 
+TEST(tinyopt, default_parser_integer) {
+    EXPECT_EQ(127, to::default_parser<short>()("+127").value());
+    EXPECT_EQ(-32768, to::default_parser<short>()("-32768").value());
+    EXPECT_FALSE(to::default_parser<short>()("32768"));
+    EXPECT_FALSE(to::default_parser<short>()("-32769"));
+
+    EXPECT_EQ(0u, to::default_parser<unsigned>()("0").value());
+    EXPECT_EQ(4294967295ull, to::default_parser<unsigned long long>()("4294967295").value());
+    EXPECT_EQ(18446744073709551615ull, to::default_parser<unsigned long long>()("18446744073709551615").value());
+    EXPECT_FALSE(to::default_parser<unsigned long long>()("18446744073709551616"));
+    EXPECT_FALSE(to::default_parser<unsigned>()("-1"));
+
+    EXPECT_EQ(std::numeric_limits<long long>::min(), to::default_parser<long long>()("-9223372036854775808").value());
+    EXPECT_FALSE(to::default_parser<long long>()("9223372036854775808"));
+
+    EXPECT_FALSE(to::default_parser<int>()("-"));
+    EXPECT_FALSE(to::default_parser<int>()("+-1"));
+    EXPECT_FALSE(to::default_parser<int>()("1 2"));
+    EXPECT_FALSE(to::default_parser<int>()("1.0"));
+    EXPECT_EQ(12, to::default_parser<int>()("\t012\n").value());
+}
+
+TEST(tinyopt, default_parser_float) {
+    EXPECT_EQ(1.5, to::default_parser<double>()("1.5").value());
+    EXPECT_EQ(-0.25, to::default_parser<double>()(" -.25 ").value());
+    EXPECT_EQ(3., to::default_parser<double>()("+3.").value());
+    EXPECT_EQ(1.25e10, to::default_parser<double>()("1.25E+10").value());
+    EXPECT_EQ(0.1f, to::default_parser<float>()("0.1").value());
+    EXPECT_EQ(0.1L, to::default_parser<long double>()("0.1").value());
+
+    EXPECT_FALSE(to::default_parser<double>()(""));
+    EXPECT_FALSE(to::default_parser<double>()("."));
+    EXPECT_FALSE(to::default_parser<double>()("1e"));
+    EXPECT_FALSE(to::default_parser<double>()("1e+"));
+    EXPECT_FALSE(to::default_parser<double>()("1.0x"));
+    EXPECT_FALSE(to::default_parser<double>()("0x10"));
+    EXPECT_FALSE(to::default_parser<double>()("inf"));
+    EXPECT_FALSE(to::default_parser<double>()("1e400"));
+    EXPECT_FALSE(to::default_parser<float>()("1e40"));
+}
+
+TEST(tinyopt, default_parser_bool_char) {
+    EXPECT_EQ(true, to::default_parser<bool>()("1").value());
+    EXPECT_EQ(false, to::default_parser<bool>()(" 0 ").value());
+    EXPECT_FALSE(to::default_parser<bool>()("2"));
+    EXPECT_FALSE(to::default_parser<bool>()("true"));
+
+    EXPECT_EQ('x', to::default_parser<char>()("x").value());
+    EXPECT_EQ('x', to::default_parser<char>()(" x\t").value());
+    EXPECT_EQ('7', to::default_parser<unsigned char>()("7").value());
+    EXPECT_FALSE(to::default_parser<char>()(""));
+    EXPECT_FALSE(to::default_parser<char>()("  "));
+    EXPECT_FALSE(to::default_parser<char>()("xy"));
+}
+
 TEST(tinyopt, keywords) {
     std::pair<const char*, int> kw[] = {
         { "one", 1 }, { "two", 2}
@@ -61,6 +133,50 @@ TEST(tinyopt, keywords) {
     EXPECT_FALSE(parser("on"));
 }
 
+TEST(tinyopt, keywords_indexed) {
+    std::vector<std::pair<std::string, int>> kw;
+    for (int i = 0; i<1000; ++i) kw.push_back({"k"+std::to_string(i), i});
+    kw.push_back({"k10", -1});
+    kw.push_back({"", -2});
+    kw.push_back({"", -3});
+
+    auto parser = to::keywords(kw);
+    ASSERT_LT(to::keyword_parser<int>::linear_max, kw.size());
+
+    for (int i = 0; i<1000; ++i) {
+        auto p = parser(("k"+std::to_string(i)).c_str());
+        ASSERT_TRUE(p);
+        EXPECT_EQ(i, *p);
+    }
+
+    EXPECT_EQ(-2, parser("").value());
+    EXPECT_FALSE(parser("k"));
+    EXPECT_FALSE(parser("k1000"));
+    EXPECT_FALSE(parser("k10 "));
+    EXPECT_FALSE(parser(nullptr));
+}
+
+TEST(tinyopt, keywords_static) {
+    static constexpr to::keyword_entry<int> kw[] = {
+        { "one", 1 }, { "two", 2 }, { "three", 3 }, { "two", 4 }, { "", 0 }
+    };
+
+    constexpr auto parser = to::keywords(kw);
+    static_assert(std::is_same<const to::static_keyword_parser<int, 5>, decltype(parser)>::value, "");
+    static_assert(std::is_trivially_destructible<decltype(parser)>::value, "");
+
+    EXPECT_EQ(1, parser("one").value());
+    EXPECT_EQ(2, parser("two").value());
+    EXPECT_EQ(3, parser("three").value());
+    EXPECT_EQ(0, parser("").value());
+
+    EXPECT_FALSE(parser("four"));
+    EXPECT_FALSE(parser(" one"));
+    EXPECT_FALSE(parser("on"));
+    EXPECT_FALSE(parser("threee"));
+    EXPECT_FALSE(parser(nullptr));
+}
+
 TEST(tinyopt, delimited) {
     using ivector = std::vector<int>;
     auto parser = to::delimited<int>('/');
@@ -78,6 +194,123 @@ TEST(tinyopt, delimited) {
     EXPECT_FALSE(parser("1a/2"));
 }
 
+TEST(tinyopt, delimited_integer) {
+    using lvector = std::vector<long long>;
+    auto parser = to::delimited<long long>();
+
+    EXPECT_EQ((lvector{12345678, 123456789, -1, 0, 7}), parser("12345678,123456789, -1 ,0000000000000,+7").value());
+    EXPECT_EQ((lvector{9223372036854775807ll, -9223372036854775807ll-1}),
+        parser("9223372036854775807,-9223372036854775808").value());
+    EXPECT_FALSE(parser("9223372036854775808"));
+    EXPECT_FALSE(parser("1,,2"));
+    EXPECT_FALSE(parser("1,2,"));
+    EXPECT_FALSE(parser("1 2,3"));
+    EXPECT_FALSE(parser("12345678x,1"));
+    EXPECT_FALSE(parser("1,--2"));
+
+    auto sparser = to::delimited<short>(';');
+    EXPECT_EQ((std::vector<short>{32767, -32768}), sparser("32767;-32768").value());
+    EXPECT_FALSE(sparser("00000000032768"));
+    EXPECT_FALSE(sparser("99999999"));
+
+    // Delimiters that can appear within an integer element.
+    using ivector = std::vector<int>;
+    EXPECT_EQ((ivector{1, 5}), to::delimited<int>('0')("105").value());
+    EXPECT_EQ((ivector{1, 2}), to::delimited<int>(' ')("1 2").value());
+    EXPECT_EQ((ivector{1, 2}), to::delimited<int>('-')("1-2").value());
+    EXPECT_FALSE(to::delimited<int>('+')("1++2"));
+
+    // Compare against element-wise parsing over varying digit counts.
+    std::string text;
+    std::vector<unsigned long long> expected;
+    unsigned long long x = 1;
+    for (int i = 0; i<64; ++i) {
+        if (i) text += ',';
+        text += std::to_string(x);
+        expected.push_back(x);
+        x = x*3+i%7;
+    }
+    EXPECT_EQ(expected, to::delimited<unsigned long long>()(text.c_str()).value());
+}
+
+TEST(tinyopt, delimited_range) {
+    using dvector = std::vector<double>;
+
+    // Elements are not NUL-terminated: delimiters that could continue
+    // a value must not be consumed by the element parser.
+    EXPECT_EQ((dvector{1., 5.}), to::delimited<double>('.')("1.5").value());
+    EXPECT_EQ((dvector{1., 2.}), to::delimited<double>('e')("1e2").value());
+    EXPECT_EQ((dvector{-1.5, 2.}), to::delimited<double>()(" -1.5 ,2").value());
+    EXPECT_FALSE(to::delimited<double>('.')("1..5"));
+
+    // Element parsers without a range overload are given a NUL-terminated copy.
+    int calls = 0;
+    auto cstr_parser = [&calls](const char* s) { return ++calls, to::just(std::string(s)+"!"); };
+    auto p = to::delimited(':', cstr_parser)("ab::c");
+    ASSERT_TRUE(p);
+    EXPECT_EQ((std::vector<std::string>{"ab!", "!", "c!"}), *p);
+    EXPECT_EQ(3, calls);
+
+    const char text[] = "12345,x";
+    EXPECT_EQ(123, to::default_parser<int>()(text, text+3).value());
+    EXPECT_EQ("123"s, to::default_parser<std::string>()(text, text+3).value());
+    EXPECT_FALSE(to::default_parser<int>()(text, text+6));
+
+    // Floating point ranges are not read past their end, whether or not
+    // the following characters would continue the value.
+    const char digits[] = "2.57";
+    EXPECT_EQ(2.5, to::default_parser<double>()(digits, digits+3).value());
+
+    std::unique_ptr<char[]> unterminated(new char[4]);
+    std::memcpy(unterminated.get(), "-0.5", 4);
+    EXPECT_EQ(-0.5, to::default_parser<double>()(unterminated.get(), unterminated.get()+4).value());
+    EXPECT_EQ(-0.5f, to::default_parser<float>()(unterminated.get(), unterminated.get()+4).value());
+
+    std::string long_float = "1."+std::string(70, '0')+"1x";
+    EXPECT_DOUBLE_EQ(1., to::default_parser<double>()(long_float.data(), long_float.data()+73).value());
+}
+
+TEST(tinyopt, delimited_streaming) {
+    auto parser = to::delimited<int>();
+
+    std::vector<int> seen;
+    auto record = [&seen](int n) { seen.push_back(n); };
+
+    EXPECT_TRUE(parser.for_each("3,1,2", record));
+    EXPECT_EQ((std::vector<int>{3, 1, 2}), seen);
+
+    seen.clear();
+    EXPECT_TRUE(parser.for_each("", record));
+    EXPECT_TRUE(seen.empty());
+    EXPECT_FALSE(parser.for_each(nullptr, record));
+
+    EXPECT_FALSE(parser.for_each("1,2,x,4", record));
+    EXPECT_EQ((std::vector<int>{1, 2}), seen);
+
+    seen.clear();
+    EXPECT_FALSE(parser.for_each("1,2,x,4", record, true));
+    EXPECT_TRUE(seen.empty());
+
+    int out[4] = {};
+    auto r = parser.copy("7,8,9", out);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(out+3, *r);
+    EXPECT_EQ(7, out[0]);
+    EXPECT_EQ(9, out[2]);
+
+    EXPECT_FALSE(parser.copy("7,8,", out, true));
+
+    // Validation parses each element without storing it, then again as
+    // it is passed on.
+    int n_parse = 0;
+    auto counted = to::delimited(',', [&n_parse](const char* s) { ++n_parse; return to::default_parser<int>{}(s); });
+
+    seen.clear();
+    EXPECT_TRUE(counted.for_each("4,5,6", record, true));
+    EXPECT_EQ((std::vector<int>{4, 5, 6}), seen);
+    EXPECT_EQ(6, n_parse);
+}
+
 TEST(tinyopt, delimited_empty) {
     auto parser = to::delimited<std::string>('/');
 
@@ -127,3 +360,590 @@ TEST(tinyopt, delimited_custom) {
     EXPECT_FALSE(delim_parser("one, one,two"));
     EXPECT_FALSE(delim_parser("one,three"));
 }
+
+TEST(tinyopt, tuple_array) {
+    auto p1 = to::tuple_of<int, double, std::string>()("3,2.5,abc");
+    ASSERT_TRUE(p1);
+    EXPECT_EQ(3, std::get<0>(*p1));
+    EXPECT_EQ(2.5, std::get<1>(*p1));
+    EXPECT_EQ("abc"s, std::get<2>(*p1));
+
+    // Wrong arity or a bad element is a parse failure.
+    auto parser = to::tuple_of<int, int>('x');
+    EXPECT_EQ(std::make_tuple(640, 480), parser("640x480").value());
+    EXPECT_FALSE(parser("640"));
+    EXPECT_FALSE(parser("640x480x24"));
+    EXPECT_FALSE(parser("640xy"));
+    EXPECT_FALSE(parser(nullptr));
+
+    std::pair<const char*, int> kw[] = {{"lo", 0}, {"hi", 1}};
+    auto p2 = to::tuple_of(':', to::keywords(kw), to::default_parser<unsigned>())("hi:17");
+    ASSERT_TRUE(p2);
+    EXPECT_EQ(std::make_tuple(1, 17u), *p2);
+
+    auto p3 = to::array_of<double, 3>()("1,-2.5,3e2");
+    ASSERT_TRUE(p3);
+    EXPECT_EQ((std::array<double, 3>{{1., -2.5, 300.}}), *p3);
+    EXPECT_FALSE((to::array_of<double, 3>()("1,2")));
+    EXPECT_FALSE((to::array_of<double, 3>()("1,2,3,")));
+
+    auto p4 = to::array_of<2>('/', to::keywords(kw))("lo/hi");
+    ASSERT_TRUE(p4);
+    EXPECT_EQ((std::array<int, 2>{{0, 1}}), *p4);
+
+    auto p5 = to::array_of<std::string, 2>('=')("=");
+    ASSERT_TRUE(p5);
+    EXPECT_EQ((std::array<std::string, 2>{{"", ""}}), *p5);
+}
+
+TEST(tinyopt, nested) {
+    using ivector = std::vector<int>;
+    using zvector = std::vector<std::size_t>;
+
+    auto p1 = to::nested<int>()("1,2,3;4;;5, 6");
+    ASSERT_TRUE(p1);
+    EXPECT_EQ(4u, p1->rows());
+    EXPECT_EQ((ivector{1, 2, 3, 4, 5, 6}), p1->values);
+    EXPECT_EQ((zvector{0, 3, 4, 4, 6}), p1->offsets);
+    EXPECT_EQ(0u, p1->row_size(2));
+    EXPECT_EQ((ivector{5, 6}), ivector(p1->begin(3), p1->end(3)));
+    EXPECT_FALSE(p1->rectangular());
+
+    auto p2 = to::nested<int>()("");
+    ASSERT_TRUE(p2);
+    EXPECT_EQ(0u, p2->rows());
+    EXPECT_TRUE(p2->values.empty());
+
+    EXPECT_FALSE(to::nested<int>()("1,2;x"));
+    EXPECT_FALSE(to::nested<int>()("1,2;3,"));
+    EXPECT_FALSE(to::nested<int>()(nullptr));
+
+    // Element parsers without a range overload.
+    auto upper = [](const char* s) { std::string u(s); for (auto& c: u) c = std::toupper(c); return to::just(u); };
+    auto p3 = to::nested('/', ':', upper)("a:b/c");
+    ASSERT_TRUE(p3);
+    EXPECT_EQ((std::vector<std::string>{"A", "B", "C"}), p3->values);
+    EXPECT_EQ((zvector{0, 2, 3}), p3->offsets);
+
+    auto m = to::matrix<double>()("1,2,3;4,5,6");
+    ASSERT_TRUE(m);
+    EXPECT_EQ(2u, m->rows());
+    EXPECT_EQ(3u, m->row_size(0));
+    EXPECT_TRUE(m->rectangular());
+    EXPECT_EQ(6., m->values.data()[5]);
+
+    EXPECT_FALSE(to::matrix<double>()("1,2,3;4,5"));
+    EXPECT_FALSE(to::matrix<double>()("1,2;3,4;"));
+    EXPECT_TRUE(to::matrix<double>(' ', ',')("1,0 0,1"));
+}
+
+TEST(tinyopt, intervals) {
+    using ivector = std::vector<int>;
+    auto parser = to::intervals<int>();
+
+    auto s1 = parser("3,10-12,20-30:5, 40 - 41 ");
+    ASSERT_TRUE(s1);
+    EXPECT_EQ(4u, s1->intervals().size());
+    EXPECT_EQ((ivector{3, 10, 11, 12, 20, 25, 30, 40, 41}), ivector(s1->begin(), s1->end()));
+    EXPECT_TRUE(s1->contains(25));
+    EXPECT_FALSE(s1->contains(26));
+    EXPECT_FALSE(s1->contains(4));
+
+    auto s2 = parser("");
+    ASSERT_TRUE(s2);
+    EXPECT_TRUE(s2->empty());
+    EXPECT_EQ(s2->begin(), s2->end());
+
+    EXPECT_FALSE(parser("3-1"));
+    EXPECT_FALSE(parser("1-3:0"));
+    EXPECT_FALSE(parser("1-3:"));
+    EXPECT_FALSE(parser("1,,3"));
+    EXPECT_FALSE(parser("1-3-5"));
+    EXPECT_FALSE(parser("x"));
+
+    // Negative bounds for signed types.
+    auto s3 = to::intervals<int>(';')("-3--1:2;1");
+    ASSERT_TRUE(s3);
+    EXPECT_EQ((ivector{-3, -1, 1}), ivector(s3->begin(), s3->end()));
+}
+
+TEST(tinyopt, intervals_large) {
+    auto s = to::intervals<std::uint64_t>()("0-999999999:4,1000000000-").value();
+    EXPECT_EQ(2u, s.intervals().size());
+    EXPECT_TRUE(s.contains(999999996));
+    EXPECT_FALSE(s.contains(999999998));
+    EXPECT_TRUE(s.contains(std::numeric_limits<std::uint64_t>::max()));
+
+    // Iteration stops at the end of an interval that reaches the maximum value.
+    auto t = to::intervals<unsigned char>()("250-:2").value();
+    EXPECT_EQ((std::vector<unsigned char>{250, 252, 254}), std::vector<unsigned char>(t.begin(), t.end()));
+}
+
+TEST(tinyopt, cpulist) {
+    using zvector = std::vector<std::size_t>;
+    auto parser = to::cpulist();
+
+    auto c1 = parser("0-3,8-11,32,130-131\n");
+    ASSERT_TRUE(c1);
+    EXPECT_EQ(11u, c1->count());
+    EXPECT_EQ((zvector{0, 1, 2, 3, 8, 9, 10, 11, 32, 130, 131}), zvector(c1->begin(), c1->end()));
+    EXPECT_TRUE(c1->test(9));
+    EXPECT_FALSE(c1->test(12));
+    EXPECT_FALSE(c1->test(1000));
+    EXPECT_EQ(3u, c1->words().size());
+    EXPECT_EQ(0x100000f0full, c1->words()[0]);
+
+    auto c2 = parser("");
+    ASSERT_TRUE(c2);
+    EXPECT_TRUE(c2->empty());
+    EXPECT_EQ(c2->begin(), c2->end());
+
+    auto c3 = parser("5,5-5");
+    ASSERT_TRUE(c3);
+    EXPECT_EQ((zvector{5}), zvector(c3->begin(), c3->end()));
+
+    EXPECT_FALSE(parser("3-1"));
+    EXPECT_FALSE(parser("-1"));
+    EXPECT_FALSE(parser("0-"));
+    EXPECT_FALSE(parser("0,,1"));
+    EXPECT_FALSE(parser("65536"));
+    EXPECT_TRUE(parser("65535"));
+
+    EXPECT_FALSE(to::cpulist(8)("0-8"));
+    EXPECT_TRUE(to::cpulist(8)("0-7"));
+}
+
+TEST(tinyopt, binary) {
+    using bytes = std::vector<unsigned char>;
+    to::hex_parser hex;
+
+    EXPECT_EQ((bytes{0x01, 0xab, 0xCD, 0xef}), hex("01abCDef").value());
+    EXPECT_EQ((bytes{0xff, 0x00}), hex("0xff00").value());
+    EXPECT_EQ(bytes{}, hex("").value());
+    EXPECT_FALSE(hex("abc"));
+    EXPECT_FALSE(hex("0g"));
+    EXPECT_FALSE(hex("00 1"));
+    EXPECT_FALSE(hex(nullptr));
+
+    to::base64_parser b64;
+    auto str = [](const bytes& b) { return std::string(b.begin(), b.end()); };
+
+    EXPECT_EQ("", str(b64("").value()));
+    EXPECT_EQ("f", str(b64("Zg==").value()));
+    EXPECT_EQ("fo", str(b64("Zm8=").value()));
+    EXPECT_EQ("foo", str(b64("Zm9v").value()));
+    EXPECT_EQ("foobar", str(b64("Zm9vYmFy").value()));
+    EXPECT_EQ("fooba", str(b64("Zm9vYmE").value()));
+    EXPECT_FALSE(b64("Zm9vY"));
+    EXPECT_FALSE(b64("Zm9=v"));
+    EXPECT_FALSE(b64("Zg="));
+    EXPECT_FALSE(b64("===="));
+    EXPECT_FALSE(b64("Zm9v\n"));
+
+    EXPECT_EQ((bytes{0xfb, 0xff}), b64("+/8=").value());
+    EXPECT_FALSE(b64("-_8="));
+    EXPECT_EQ((bytes{0xfb, 0xff}), to::base64_parser(true)("-_8").value());
+
+    // Decoding into caller-provided storage.
+    unsigned char key[4] = {};
+    auto r = hex.copy("deadbeef", key);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(key+4, *r);
+    EXPECT_EQ(0xde, key[0]);
+    EXPECT_EQ(0xef, key[3]);
+
+    bytes buf;
+    EXPECT_TRUE(b64.copy("Zm9vYmFy", std::back_inserter(buf)));
+    EXPECT_EQ("foobar", str(buf));
+
+    // Composition with other parsers.
+    auto keys = to::delimited(',', hex)("00ff,10");
+    ASSERT_TRUE(keys);
+    EXPECT_EQ(2u, keys->size());
+    EXPECT_EQ((bytes{0x10}), keys->at(1));
+
+    bytes seed;
+    to::sink s(seed, hex);
+    EXPECT_TRUE(s("0a0b"));
+    EXPECT_EQ((bytes{0x0a, 0x0b}), seed);
+    EXPECT_FALSE(s("0z"));
+    EXPECT_EQ((bytes{0x0a, 0x0b}), seed);
+}
+
+TEST(tinyopt, sizes) {
+    to::size_parser size;
+
+    EXPECT_EQ(0u, size("0").value());
+    EXPECT_EQ(512u, size("512").value());
+    EXPECT_EQ(512u, size(" 512 B ").value());
+    EXPECT_EQ(4000u, size("4k").value());
+    EXPECT_EQ(4000u, size("4KB").value());
+    EXPECT_EQ(4096u, size("4KiB").value());
+    EXPECT_EQ(4096u, size("4Ki").value());
+    EXPECT_EQ(4294967296u, size("4GiB").value());
+    EXPECT_EQ(1500000u, size("1.5M").value());
+    EXPECT_EQ(1536u, size("1.50KiB").value());
+    EXPECT_EQ(std::uint64_t(1)<<60, size("1EiB").value());
+    EXPECT_EQ(std::numeric_limits<std::uint64_t>::max(), size("18446744073709551615").value());
+
+    EXPECT_FALSE(size(""));
+    EXPECT_FALSE(size("k"));
+    EXPECT_FALSE(size("."));
+    EXPECT_FALSE(size("-1"));
+    EXPECT_FALSE(size("4b"));
+    EXPECT_FALSE(size("4 GiBs"));
+    EXPECT_FALSE(size("4iB"));
+    EXPECT_FALSE(size("1.5"));
+    EXPECT_FALSE(size("0.1KiB"));
+    EXPECT_FALSE(size("16EiB"));
+    EXPECT_FALSE(size("18446744073709551616"));
+    EXPECT_FALSE(size(nullptr));
+}
+
+TEST(tinyopt, durations) {
+    using namespace std::chrono;
+
+    to::duration_parser<> ns;
+    EXPECT_EQ(250ms, ns("250ms").value());
+    EXPECT_EQ(250ms, ns(" 250 ms ").value());
+    EXPECT_EQ(1500us, ns("1.5ms").value());
+    EXPECT_EQ(3us, ns("3\xc2\xb5s").value());
+    EXPECT_EQ(90min, ns("1h30m").value());
+    EXPECT_EQ(90min, ns("1h 30min").value());
+    EXPECT_EQ(hours(48), ns("2d").value());
+    EXPECT_EQ(17ns, ns("17").value());
+
+    EXPECT_FALSE(ns(""));
+    EXPECT_FALSE(ns("ms"));
+    EXPECT_FALSE(ns("5 parsecs"));
+    EXPECT_FALSE(ns("1h30"));
+    EXPECT_FALSE(ns("0.5ns"));
+    EXPECT_FALSE(ns("-1s"));
+    EXPECT_FALSE(ns("300y"));
+    EXPECT_FALSE(ns("1000000d"));
+    EXPECT_FALSE(ns(nullptr));
+
+    to::duration_parser<seconds> s;
+    EXPECT_EQ(30s, s("30").value());
+    EXPECT_EQ(120s, s("2m").value());
+    EXPECT_FALSE(s("250ms"));
+    EXPECT_EQ(1s, s("1000ms").value());
+
+    to::duration_parser<duration<double>> fs;
+    EXPECT_DOUBLE_EQ(0.25, fs("250ms").value().count());
+    EXPECT_DOUBLE_EQ(3600.5, fs("1h 0.5s").value().count());
+
+    milliseconds flush{};
+    to::sink sink(flush, to::duration_parser<milliseconds>{});
+    EXPECT_TRUE(sink("2s"));
+    EXPECT_EQ(2000ms, flush);
+}
+
+#if __cplusplus>=201703
+TEST(tinyopt, string_view) {
+    const char text[] = "alpha,beta";
+    auto v = to::default_parser<std::string_view>()(text);
+    ASSERT_TRUE(v);
+    EXPECT_EQ(text, v->data());
+    EXPECT_EQ(10u, v->size());
+    EXPECT_FALSE(to::default_parser<std::string_view>()(nullptr));
+
+    // Delimited views refer into the original text.
+    auto vs = to::delimited<std::string_view>()(text);
+    ASSERT_TRUE(vs);
+    ASSERT_EQ(2u, vs->size());
+    EXPECT_EQ("beta"sv, vs->at(1));
+    EXPECT_EQ(text+6, vs->at(1).data());
+
+    std::pair<std::string_view, int> kw[] = {{"alpha", 1}, {"beta", 2}};
+    auto kp = to::keywords(kw);
+    EXPECT_EQ(2, kp(vs->at(1)).value());
+    EXPECT_EQ(1, kp("alpha").value());
+    EXPECT_FALSE(kp("alpha,beta"sv.substr(0, 4)));
+
+    constexpr to::keyword_entry<int> skw[] = {{"alpha", 1}, {"beta", 2}};
+    constexpr auto skp = to::keywords(skw);
+    EXPECT_EQ(1, skp(vs->at(0)).value());
+}
+#endif
+
+TEST(tinyopt, parse_into) {
+    auto parser = to::delimited<std::string>();
+
+    std::vector<std::string> out = {"a long string that will not fit in small buffer storage", "x", "y"};
+    const char* buffer = out[0].data();
+
+    ASSERT_TRUE(parser.parse_into("one,two", out));
+    EXPECT_EQ((std::vector<std::string>{"one", "two"}), out);
+    EXPECT_EQ(buffer, out[0].data());
+
+    ASSERT_TRUE(parser.parse_into("", out));
+    EXPECT_TRUE(out.empty());
+    EXPECT_FALSE(parser.parse_into(nullptr, out));
+
+    auto ints = to::delimited<int>();
+    std::vector<int> iv(100);
+    const int* data = iv.data();
+    ASSERT_TRUE(ints.parse_into("4,5,6", iv));
+    EXPECT_EQ((std::vector<int>{4, 5, 6}), iv);
+    EXPECT_EQ(data, iv.data());
+    EXPECT_FALSE(ints.parse_into("4,x", iv));
+
+    // Element parsers with only the maybe<V> protocol.
+    std::pair<const char*, int> kw[] = {{"one", 1}, {"two", 2}};
+    auto kws = to::delimited(',', to::keywords(kw));
+    ASSERT_TRUE(kws.parse_into("two,one", iv));
+    EXPECT_EQ((std::vector<int>{2, 1}), iv);
+
+    auto m = to::matrix<int>();
+    to::ragged_array<int> a;
+    ASSERT_TRUE(m.parse_into("1,2;3,4", a));
+    ASSERT_TRUE(m.parse_into("5;6", a));
+    EXPECT_EQ((std::vector<int>{5, 6}), a.values);
+    EXPECT_EQ((std::vector<std::size_t>{0, 1, 2}), a.offsets);
+}
+
+TEST(tinyopt, combinators) {
+    constexpr to::keyword_entry<int> kw[] = {{"auto", -1}, {"none", 0}};
+    auto level = to::keywords(kw) | to::in_range(to::default_parser<int>{}, 1, 9);
+
+    EXPECT_EQ(-1, level("auto").value());
+    EXPECT_EQ(0, level("none").value());
+    EXPECT_EQ(5, level("5").value());
+    EXPECT_FALSE(level("10"));
+    EXPECT_FALSE(level("0"));
+    EXPECT_FALSE(level("never"));
+
+    // Range overloads are forwarded, so elements are parsed in place.
+    static_assert(to::impl::is_range_parser<decltype(level)>::value, "range overload");
+    EXPECT_EQ((std::vector<int>{-1, 3, 0}), to::delimited(',', level)("auto,3,none").value());
+
+    auto f = to::in_range(to::default_parser<double>{}, 0, 1);
+    EXPECT_EQ(0.5, f("0.5").value());
+    EXPECT_FALSE(f("1.5"));
+
+    auto even = to::validate(to::default_parser<int>{}, [](int n) { return n%2==0; });
+    EXPECT_EQ(4, even("4").value());
+    EXPECT_FALSE(even("3"));
+
+    auto length = to::transform(to::default_parser<std::string>{}, [](const std::string& s) { return s.size(); });
+    EXPECT_EQ(3u, length("abc").value());
+
+    auto opt = to::optional(to::default_parser<int>{});
+    ASSERT_TRUE(opt(""));
+    EXPECT_FALSE(*opt(""));
+    EXPECT_EQ(3, opt("3").value().value());
+    EXPECT_FALSE(opt("x"));
+
+    to::maybe<int> m = 1;
+    to::sink s(m, opt);
+    EXPECT_TRUE(s(""));
+    EXPECT_FALSE(m);
+
+    auto dflt = to::optional(to::default_parser<int>{}, 7);
+    EXPECT_EQ(7, dflt("").value());
+    EXPECT_EQ(2, dflt("2").value());
+    EXPECT_FALSE(dflt("x"));
+
+    auto seq = to::sequence(':', to::keywords(kw), to::in_range(to::default_parser<unsigned>{}, 1u, 100u));
+    EXPECT_EQ(std::make_tuple(-1, 10u), seq("auto:10").value());
+    EXPECT_FALSE(seq("auto:0"));
+}
+
+TEST(tinyopt, memoize) {
+    int calls = 0;
+    auto count_parser = [&calls](const char* s) { return ++calls, to::default_parser<int>{}(s); };
+    auto parser = to::memoize(count_parser, 2);
+
+    EXPECT_EQ(3, parser("3").value());
+    EXPECT_EQ(3, parser("3").value());
+    EXPECT_FALSE(parser("x"));
+    EXPECT_FALSE(parser("x"));
+    EXPECT_EQ(2, calls);
+    EXPECT_EQ(2u, parser.hits());
+    EXPECT_EQ(2u, parser.misses());
+    EXPECT_EQ(2u, parser.size());
+
+    // Least recently used entry ("3") is evicted.
+    EXPECT_EQ(4, parser("4").value());
+    EXPECT_EQ(2u, parser.size());
+    EXPECT_FALSE(parser("x"));
+    EXPECT_EQ(3, calls);
+    EXPECT_EQ(3, parser("3").value());
+    EXPECT_EQ(4, calls);
+
+    // Copies share the cache.
+    std::vector<int> v;
+    auto pb = to::push_back(v, parser);
+    EXPECT_TRUE(pb("3"));
+    EXPECT_EQ(4, calls);
+    EXPECT_EQ(4u, parser.hits());
+
+    // Range arguments are looked up without copying when found.
+    const char text[] = "3,4";
+    EXPECT_EQ(3, parser(text, text+1).value());
+    EXPECT_EQ(4, calls);
+
+    parser.clear();
+    EXPECT_EQ(0u, parser.size());
+    EXPECT_EQ(0u, parser.hits());
+    EXPECT_EQ(3, parser("3").value());
+    EXPECT_EQ(5, calls);
+
+    auto lists = to::memoize(to::delimited<int>());
+    EXPECT_EQ((std::vector<int>{1, 2}), lists("1,2").value());
+    EXPECT_EQ((std::vector<int>{1, 2}), lists("1,2").value());
+    EXPECT_EQ(1u, lists.hits());
+
+    // Values referring to the argument text refer to the cached copy.
+    auto pointers = to::memoize([](const char* s) { return to::just(s); }, 2);
+    std::string abc = "abc";
+    const char* p1 = pointers(abc.c_str()).value();
+    EXPECT_NE(abc.c_str(), p1);
+    EXPECT_EQ(p1, pointers("abc").value());
+    const char* p2 = pointers("def").value();
+    EXPECT_STREQ("abc", p1);
+    EXPECT_STREQ("def", p2);
+
+#if __cplusplus>=201703
+    auto views = to::memoize(to::default_parser<std::string_view>{}, 2);
+    std::string_view v1 = views("short").value();
+    std::string_view v2 = views("a rather longer argument").value();
+    const char range[] = "short,x";
+    EXPECT_EQ(v1.data(), views(range, range+5).value().data());
+    EXPECT_EQ("short", v1);
+    EXPECT_EQ("a rather longer argument", v2);
+    EXPECT_EQ(1u, views.hits());
+#endif
+}
+
+TEST(tinyopt, mapped_keywords) {
+    std::string path = testing::TempDir()+"tinyopt_keywords.idx";
+
+    std::vector<std::pair<std::string, long>> kw;
+    for (long i = 0; i<1000; ++i) kw.emplace_back("SKU-"+std::to_string(i*7919), i);
+    kw.emplace_back("SKU-0", 42); // Repeated key: first value is kept.
+    kw.emplace_back("", -1);
+
+    {
+        std::ofstream out(path, std::ios::binary);
+        to::write_keyword_index(out, kw);
+    }
+
+    to::mapped_keyword_parser parser(path);
+    EXPECT_EQ(1001u, parser.size());
+    EXPECT_EQ(0, parser("SKU-0").value());
+    EXPECT_EQ(999, parser("SKU-7911081").value());
+    EXPECT_EQ(-1, parser("").value());
+    EXPECT_FALSE(parser("SKU-1"));
+    EXPECT_FALSE(parser("SKU-79"));
+    EXPECT_FALSE(parser(nullptr));
+
+    const char text[] = "SKU-7919,SKU-15838";
+    EXPECT_EQ((std::vector<std::int64_t>{1, 2}), to::delimited(',', parser)(text).value());
+
+    {
+        std::istringstream in("# comment\nalpha 1\n\n  beta\t-20  \nalpha 3\n");
+        std::ofstream out(path, std::ios::binary);
+        to::build_keyword_index(in, out);
+    }
+
+    to::mapped_keyword_parser parser2(path);
+    EXPECT_EQ(2u, parser2.size());
+    EXPECT_EQ(1, parser2("alpha").value());
+    EXPECT_EQ(-20, parser2("beta").value());
+
+    std::istringstream bad("alpha 1\nbeta\n");
+    std::ostringstream sink;
+    EXPECT_THROW(to::build_keyword_index(bad, sink), std::runtime_error);
+
+    // Lookups terminate in a corrupt index with no empty slot.
+    {
+        std::istringstream in("alpha 1\n");
+        std::ostringstream out;
+        to::build_keyword_index(in, out);
+
+        std::string index = out.str();
+        const std::uint32_t full[2] = {1, 1};
+        index.replace(sizeof(to::impl::keyword_index_header), sizeof(full), reinterpret_cast<const char*>(full), sizeof(full));
+        std::ofstream(path, std::ios::binary) << index;
+    }
+
+    to::mapped_keyword_parser parser3(path);
+    EXPECT_EQ(1, parser3("alpha").value());
+    EXPECT_FALSE(parser3("beta"));
+
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "not an index";
+    }
+    EXPECT_THROW(to::mapped_keyword_parser{path}, std::runtime_error);
+    std::remove(path.c_str());
+
+    EXPECT_THROW(to::mapped_keyword_parser{path}, std::runtime_error);
+}
+
+TEST(tinyopt, mapped_files) {
+    std::string path = testing::TempDir()+"tinyopt_payload.bin";
+    std::string arg = "@"+path;
+
+    const double weights[] = {0.5, -1.25, 3., 1e10};
+    {
+        std::ofstream out(path, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(weights), sizeof(weights));
+    }
+
+    to::mapped_span<double> w;
+    {
+        to::sink s(w, to::mapped_array<double>());
+        EXPECT_TRUE(s(arg.c_str()));
+    }
+    ASSERT_EQ(4u, w.size());
+    EXPECT_EQ(-1.25, w[1]);
+    EXPECT_TRUE(std::equal(w.begin(), w.end(), weights));
+
+    EXPECT_TRUE(to::mapped_array<double>(4)(arg.c_str()));
+    EXPECT_FALSE(to::mapped_array<double>(3)(arg.c_str()));
+    EXPECT_EQ(32u, to::mapped_array<char>()(arg.c_str()).value().size());
+    EXPECT_FALSE(to::mapped_array<double>()(path.c_str()));
+    EXPECT_FALSE(to::mapped_array<double>()(nullptr));
+
+    // Truncating a mapped file is an error, so text payloads use another file.
+    std::string weights_path = path;
+    path = testing::TempDir()+"tinyopt_payload.txt";
+    arg = "@"+path;
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "alpha\n\nbeta\ngamma\n";
+    }
+    EXPECT_FALSE(to::mapped_array<double>()(arg.c_str()));
+
+    auto text = to::mapped_lines()(arg.c_str());
+    ASSERT_TRUE(text);
+    std::vector<std::string> lines;
+    for (const auto& r: *text) lines.push_back(r.str());
+    EXPECT_EQ((std::vector<std::string>{"alpha", "", "beta", "gamma"}), lines);
+
+    {
+        std::ofstream out(path, std::ios::binary);
+        out.write("one\0two", 7);
+    }
+    auto records = to::mapped_lines('\0')(arg.c_str());
+    ASSERT_TRUE(records);
+    ASSERT_EQ(2, std::distance(records->begin(), records->end()));
+    EXPECT_EQ("two", std::next(records->begin())->str());
+
+    {
+        std::ofstream out(path, std::ios::binary);
+    }
+    auto empty = to::mapped_lines()(arg.c_str());
+    ASSERT_TRUE(empty);
+    EXPECT_TRUE(empty->begin()==empty->end());
+
+    std::remove(path.c_str());
+    EXPECT_FALSE(to::mapped_lines()(arg.c_str()));
+
+    // The mapping outlives removal of the file.
+    std::remove(weights_path.c_str());
+    EXPECT_EQ(3., w[2]);
+}
@@ -230,6 +230,16 @@ TEST(run, keyless) {
     EXPECT_TRUE(a);
     EXPECT_EQ("foo"s, kl_first);
     EXPECT_EQ(3, kl_second);
+
+    // A flag without keys matches nothing.
+    int n = 0;
+    to::option flags[] = {{to::increment(n), to::flag}};
+
+    mockargs M3("foo\0bar\0");
+    auto r3 = to::run(flags, M3.argc, M3.argv);
+    ASSERT_TRUE(r3);
+    EXPECT_EQ(0, n);
+    EXPECT_EQ(2, M3.argc);
 }
 
 TEST(run, modal) {
@@ -250,3 +260,205 @@ TEST(run, modal) {
     EXPECT_EQ(3, a1);
     EXPECT_EQ(2, a2);
 }
+
+TEST(run, shared_keys) {
+    using namespace to::literals;
+
+    // Options sharing a key are tried in declaration order; a lax option
+    // that fails to parse its argument defers to those that follow.
+    int n = 0;
+    std::string s;
+    bool c = false, v = false;
+    to::option opts[] = {
+        {n, "--value", "-n", to::lax},
+        {s, "-s", "--value"},
+        {to::set(c), "-c"_compact, to::flag},
+        {to::set(v), "-v"_compact, "--value", to::flag}
+    };
+
+    mockargs M1("--value=3\0--value=three\0");
+    auto r1 = to::run(opts, M1.argc, M1.argv);
+    ASSERT_TRUE(r1);
+    EXPECT_EQ(3, n);
+    EXPECT_EQ("three"s, s);
+    EXPECT_EQ((svector{"--value", "3", "--value", "three"}), svector(r1->begin(), r1->end()));
+
+    n = 0;
+    s = "";
+    mockargs M2("-n\0four\0-cv\0");
+    auto r2 = to::run(opts, M2.argc, M2.argv);
+    ASSERT_TRUE(r2);
+    EXPECT_EQ(0, n);
+    EXPECT_EQ(""s, s);
+    EXPECT_TRUE(c);
+    EXPECT_TRUE(v);
+    ASSERT_EQ(2, M2.argc);
+    EXPECT_EQ("-n"s, M2.argv[0]);
+    EXPECT_EQ("four"s, M2.argv[1]);
+
+    // Flags do not match the --key=value form.
+    v = false;
+    to::option flags[] = {{to::set(v), "--value", to::flag}};
+    mockargs M3("--value=1\0");
+    auto r3 = to::run(flags, M3.argc, M3.argv);
+    ASSERT_TRUE(r3);
+    EXPECT_FALSE(v);
+    EXPECT_EQ(1, M3.argc);
+}
+
+TEST(run, lax_failure) {
+    // A lax option that fails to parse its argument leaves its variable
+    // unchanged, even if the parser builds the value in place.
+    std::vector<int> v = {7};
+    to::option opts[] = {{{v, to::delimited<int>()}, "-v", to::lax}};
+
+    mockargs M("-v\0""1,2,x\0");
+    auto r = to::run(opts, M.argc, M.argv);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(std::vector<int>{7}, v);
+    EXPECT_EQ(2, M.argc);
+}
+
+TEST(run, compact) {
+    using namespace to::literals;
+
+    // Enough single-character flags that they share a lookup table,
+    // together with longer keys and options taking a parameter.
+    int v = 0;
+    bool x = false, y = false, z = false, q = false;
+    bool one = false, two = false, three = false;
+    int n = 0;
+    std::string s;
+    to::option opts[] = {
+        {to::increment(v), "-v"_compact, to::flag},
+        {to::set(x), "-x"_compact, to::flag},
+        {to::set(y), "-y"_compact, to::flag},
+        {to::set(z), "-z"_compact, to::flag},
+        {to::set(q), "-q"_compact, to::flag},
+        {to::set(one), "key/one"_compact, to::flag},
+        {to::set(two), "key/two"_compact, to::flag},
+        {to::set(three), "key/three"_compact, to::flag},
+        {n, "-n"_compact},
+        {s, "-s"_compact}
+    };
+
+    mockargs M1("-vvxvz\0key/one/three/two\0-vn3\0-s\0foo\0rest\0");
+    auto r1 = to::run(opts, M1.argc, M1.argv);
+    ASSERT_TRUE(r1);
+    EXPECT_EQ(4, v);
+    EXPECT_TRUE(x);
+    EXPECT_FALSE(y);
+    EXPECT_TRUE(z);
+    EXPECT_FALSE(q);
+    EXPECT_TRUE(one);
+    EXPECT_TRUE(two);
+    EXPECT_TRUE(three);
+    EXPECT_EQ(3, n);
+    EXPECT_EQ("foo"s, s);
+    ASSERT_EQ(1, M1.argc);
+    EXPECT_EQ("rest"s, M1.argv[0]);
+
+    // Unmatched characters in a cluster leave the remainder of the
+    // argument in place.
+    v = 0;
+    mockargs M2("-vwv\0");
+    auto r2 = to::run(opts, M2.argc, M2.argv);
+    ASSERT_TRUE(r2);
+    EXPECT_EQ(1, v);
+    ASSERT_EQ(1, M2.argc);
+
+    // Matching starts afresh with the argument after such a cluster.
+    v = 0;
+    x = false;
+    mockargs M3("-vw\0-x\0-v\0");
+    auto r3 = to::run(opts, M3.argc, M3.argv);
+    ASSERT_TRUE(r3);
+    EXPECT_EQ(2, v);
+    EXPECT_TRUE(x);
+    ASSERT_EQ(1, M3.argc);
+    EXPECT_EQ("-vw"s, M3.argv[0]);
+}
+
+TEST(run, long_argv) {
+    // Half of a long argument list is consumed; the remainder keeps its
+    // order and argv stays NULL-terminated. (Timing is in bench_run.)
+    int k = 0;
+    to::option opts[] = {{to::increment(k), "-k", to::flag, to::ephemeral}};
+
+    const int n = 20000;
+    std::vector<std::string> args;
+    for (int i = 0; i<n; ++i) args.push_back(i%2? "-k": std::to_string(i));
+
+    std::vector<char*> argv;
+    for (auto& a: args) argv.push_back(&a[0]);
+    argv.push_back(nullptr);
+    int argc = n;
+
+    auto r = to::run(opts, argc, argv.data());
+    ASSERT_TRUE(r);
+    EXPECT_EQ(n/2, k);
+    ASSERT_EQ(n/2, argc);
+    EXPECT_EQ(nullptr, argv[argc]);
+
+    bool ordered = true;
+    for (int i = 0; i<argc; ++i) ordered = ordered && std::to_string(2*i)==argv[i];
+    EXPECT_TRUE(ordered);
+}
+
+TEST(run, span) {
+    auto span_args = [](const to::arg_span& s) {
+        svector v;
+        for (auto a: s) v.push_back(a);
+        return v;
+    };
+
+    int a = 0;
+    bool b = false, h = false;
+    to::option opts[] = {
+        {a, "-a"},
+        {to::set(b), "-b", to::flag},
+        {to::set(h), "-h", to::flag, to::exit},
+        {{}, "--stop", to::flag, to::stop}
+    };
+
+    // Unmatched arguments, with consecutive arguments held as one range,
+    // and argv left unchanged.
+    mockargs M1("x\0-a\0003\0y\0z\0-b\0w\0");
+    std::vector<char*> v1 = M1.args;
+    to::arg_span r1;
+    auto s1 = to::run(opts, M1.argv, r1);
+    ASSERT_TRUE(s1);
+    EXPECT_EQ((svector{"-a", "3", "-b"}), svector(s1->begin(), s1->end()));
+    EXPECT_EQ(3, a);
+    EXPECT_TRUE(b);
+    EXPECT_EQ(v1, M1.args);
+    EXPECT_EQ(M1.argv, r1.argv());
+    EXPECT_EQ((svector{"x", "y", "z", "w"}), span_args(r1));
+    EXPECT_EQ(4u, r1.size());
+    using ranges = std::vector<std::pair<std::size_t, std::size_t>>;
+    EXPECT_EQ((ranges{{0, 1}, {3, 5}, {6, 7}}), r1.ranges());
+
+    std::vector<std::size_t> indices;
+    for (auto i = r1.begin(); i!=r1.end(); ++i) indices.push_back(i.index());
+    EXPECT_EQ((std::vector<std::size_t>{0, 3, 4, 6}), indices);
+
+    // The tail after "--" or a stop option follows the unmatched arguments,
+    // as in argv after a mutating run.
+    for (const char* args: {"-a\0001\0--\0-b\0y\0", "x\0-a\0001\0--stop\0-b\0y\0", "-h\0x\0-b\0"}) {
+        b = false;
+        mockargs M2(args), M3(args);
+        to::arg_span r2;
+        auto s2 = to::run(opts, M2.argv, r2);
+        auto s3 = to::run(opts, M3.argc, M3.argv);
+        EXPECT_EQ(bool(s2), bool(s3));
+        EXPECT_FALSE(b);
+        EXPECT_EQ(svector(M3.argv, M3.argv+M3.argc), span_args(r2));
+    }
+
+    // No arguments.
+    mockargs M4("");
+    to::arg_span r4;
+    EXPECT_TRUE(to::run(opts, M4.argv, r4));
+    EXPECT_TRUE(r4.empty());
+    EXPECT_EQ(r4.begin(), r4.end());
+}
@@ -1,8 +1,13 @@
 #include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <set>
 #include <string>
+#include <vector>
 
 #if __cplusplus>=201703
 #include <optional>
+#include <string_view>
 #endif
 
 #include <gtest/gtest.h>
@@ -125,3 +130,166 @@ TEST(sink, adaptors) {
     EXPECT_TRUE(a4("ketchup"));
     EXPECT_EQ(2, x);
 }
+
+TEST(sink, delimited_adaptors) {
+    int sum = 0;
+    auto a1 = to::for_each([&sum](int n) { sum += n; }, to::delimited<int>());
+
+    EXPECT_TRUE(a1("1,2,3"));
+    EXPECT_EQ(6, sum);
+    EXPECT_TRUE(a1(""));
+    EXPECT_EQ(6, sum);
+    EXPECT_FALSE(a1(nullptr));
+
+    // Without validation, elements before a parse failure are still delivered.
+    EXPECT_FALSE(a1("10,x,20"));
+    EXPECT_EQ(16, sum);
+
+    auto a2 = to::for_each([&sum](int n) { sum += n; }, to::delimited<int>(), true);
+    EXPECT_FALSE(a2("10,x,20"));
+    EXPECT_EQ(16, sum);
+    EXPECT_TRUE(a2("10,20"));
+    EXPECT_EQ(46, sum);
+
+    std::set<std::string> words;
+    auto a3 = to::copy_to(std::inserter(words, words.end()), to::delimited<std::string>(':'), true);
+    EXPECT_TRUE(a3("b:a"));
+    EXPECT_TRUE(a3("c:a"));
+    EXPECT_FALSE(a3(nullptr));
+    EXPECT_EQ((std::set<std::string>{"a", "b", "c"}), words);
+
+    std::vector<int> ns;
+    auto a4 = to::copy_to(std::back_inserter(ns), to::delimited<int>());
+    EXPECT_TRUE(a4("4,5"));
+    EXPECT_TRUE(a4("6"));
+    EXPECT_EQ((std::vector<int>{4, 5, 6}), ns);
+}
+
+namespace {
+// Records whether a value was built in place or returned by value.
+struct in_place_parser {
+    int* n_into;
+    int* n_value;
+
+    to::maybe<std::string> operator()(const char* s) const { return ++*n_value, to::just(std::string(s)); }
+
+    bool parse_into(const char* s, std::string& out) const {
+        ++*n_into;
+        if (!*s) return false;
+        out.assign(s);
+        return true;
+    }
+};
+}
+
+TEST(sink, parse_into) {
+    int n_into = 0, n_value = 0;
+    in_place_parser parser{&n_into, &n_value};
+
+    std::string s;
+    to::sink ss(s, parser);
+    EXPECT_TRUE(ss("abc"));
+    EXPECT_EQ("abc", s);
+    EXPECT_FALSE(ss(""));
+    EXPECT_EQ(2, n_into);
+    EXPECT_EQ(0, n_value);
+
+    std::vector<std::string> v;
+    auto pb = to::push_back(v, parser);
+    EXPECT_TRUE(pb("x"));
+    EXPECT_FALSE(pb(""));
+    EXPECT_TRUE(pb("y"));
+    EXPECT_EQ((std::vector<std::string>{"x", "y"}), v);
+    EXPECT_EQ(5, n_into);
+    EXPECT_EQ(0, n_value);
+
+    // A delimited parser builds the vector in place, reusing its storage.
+    std::vector<int> iv;
+    iv.reserve(64);
+    const int* data = iv.data();
+    to::sink sv(iv, to::delimited<int>());
+    EXPECT_TRUE(sv("1,2,3"));
+    EXPECT_TRUE(sv("4,5"));
+    EXPECT_EQ((std::vector<int>{4, 5}), iv);
+    EXPECT_EQ(data, iv.data());
+
+    // Parsers without parse_into are unaffected.
+    std::vector<int> pv;
+    auto pi = to::push_back(pv);
+    EXPECT_TRUE(pi("7"));
+    EXPECT_FALSE(pi("x"));
+    EXPECT_EQ(std::vector<int>{7}, pv);
+}
+
+namespace {
+struct copy_count {
+    static int copies;
+
+    std::vector<int> data;
+
+    copy_count() = default;
+    copy_count(const copy_count& x): data(x.data) { ++copies; }
+    copy_count(copy_count&&) = default;
+    copy_count& operator=(const copy_count& x) { data = x.data; ++copies; return *this; }
+    copy_count& operator=(copy_count&&) = default;
+};
+
+int copy_count::copies = 0;
+
+to::maybe<copy_count> parse_copy_count(const char* s) {
+    copy_count c;
+    c.data.assign(std::strlen(s), 1);
+    return c;
+}
+}
+
+TEST(sink, no_copies) {
+    copy_count::copies = 0;
+
+    copy_count v;
+    to::sink s(v, parse_copy_count);
+    EXPECT_TRUE(s("abc"));
+    EXPECT_EQ(3u, v.data.size());
+
+    std::size_t n = 0;
+    auto a = to::action([&n](copy_count c) { n += c.data.size(); }, parse_copy_count);
+    EXPECT_TRUE(a("abcd"));
+    EXPECT_EQ(4u, n);
+
+    std::vector<copy_count> vs;
+    auto p = to::push_back(vs, parse_copy_count);
+    EXPECT_TRUE(p("ab"));
+    EXPECT_TRUE(p("a"));
+    EXPECT_EQ(2u, vs.size());
+
+    EXPECT_EQ(0, copy_count::copies);
+}
+
+#if __cplusplus>=201703
+TEST(sink, string_view) {
+    using namespace std::literals;
+    char arg[] = "path/to/file";
+
+    std::string_view v;
+    to::sink s(v);
+    EXPECT_TRUE(s(arg));
+    EXPECT_EQ("path/to/file"sv, v);
+    EXPECT_EQ(arg, v.data());
+
+    std::vector<std::string_view> vs;
+    auto p = to::push_back(vs);
+    EXPECT_TRUE(p(arg));
+    EXPECT_TRUE(p("x"));
+    ASSERT_EQ(2u, vs.size());
+    EXPECT_EQ(arg, vs[0].data());
+
+    std::size_t n = 0;
+    auto a = to::action([&n](std::string_view v) { n += v.size(); });
+    EXPECT_TRUE(a(arg));
+    EXPECT_EQ(12u, n);
+
+    to::key k("--file"sv);
+    EXPECT_EQ("--file", k.label);
+    EXPECT_EQ(to::key::longfmt, k.style);
+}
+#endif
@@ -41,6 +41,44 @@ TEST(state, shift) {
     EXPECT_EQ(v0[4], s.argv[0]);
 }
 
+TEST(state, deferred_shift) {
+    const char* argstr = "zero\0one\0two\0three\0four\0five\0six\0";
+    mockargs M(argstr);
+
+    std::vector<char*> v0 = M.args;
+    to::state s(M.argc, M.argv);
+    s.defer();
+
+    s.shift();
+    s.skip();
+    s.shift(2);
+    EXPECT_EQ(4, M.argc);
+    EXPECT_EQ(v0[4], s.argv[0]);
+    EXPECT_EQ(v0[1], M.argv[0]);
+
+    s.skip();
+    s.shift();
+    EXPECT_EQ(3, M.argc);
+    EXPECT_EQ(v0[6], s.argv[0]);
+
+    // Compaction leaves the state at the first unprocessed argument,
+    // following those skipped.
+    s.compact();
+    EXPECT_EQ(3, M.argc);
+    EXPECT_EQ(0, M.argv[M.argc]);
+    EXPECT_EQ(v0[1], M.argv[0]);
+    EXPECT_EQ(v0[4], M.argv[1]);
+    EXPECT_EQ(v0[6], M.argv[2]);
+    EXPECT_EQ(M.argv+2, s.argv);
+
+    s.shift();
+    s.compact();
+    EXPECT_EQ(2, M.argc);
+    EXPECT_EQ(0, M.argv[M.argc]);
+    EXPECT_EQ(v0[4], M.argv[1]);
+    EXPECT_FALSE(s);
+}
+
 TEST(state, consume) {
     const char* argstr = "zero\0one\0two\0three\0four\0five\0six\0";
     mockargs M(argstr);